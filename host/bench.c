@@ -0,0 +1,383 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/wait.h>
+
+#include "memewm.h"
+#include "headless.h"
+
+/* every configuration runs in its own forked child, memewm keeps its
+   state in globals and has no way to tear a session down */
+
+typedef struct {
+    int width;
+    int height;
+} resolution_t;
+
+static const resolution_t resolutions[] = {
+    {1280, 720},
+    {1920, 1080},
+    {2560, 1440},
+    {3840, 2160},
+};
+
+static const int window_counts[] = {1, 10, 100, 1000};
+
+static const char *patterns[] = {"cascade", "tiled", "random"};
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+static uint64_t budget_ns = 200000000;
+static const char *filter = NULL;
+
+static int width;
+static int height;
+static int *ids;
+static int id_count;
+
+static uint32_t rng_state;
+
+/* compositor work done by refreshes that only reset state between batches */
+static memewm_stats_t untimed_stats;
+
+static uint32_t rng(void) {
+    rng_state = rng_state * 1103515245 + 12345;
+    return rng_state >> 8;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void create_windows(const char *pattern, int count) {
+    /* keep the surfaces of big sessions small enough to fit in memory */
+    int div = count >= 100 ? 10 : 3;
+    int w = width / div;
+    int h = height / div;
+
+    ids = malloc(count * sizeof(int));
+    id_count = count;
+
+    if (!strcmp(pattern, "tiled")) {
+        int cols = 1;
+        while (cols * cols < count)
+            cols++;
+        int rows = (count + cols - 1) / cols;
+        w = width / cols - 2;
+        h = height / rows - 19;
+        for (int i = 0; i < count; i++) {
+            int x = (i % cols) * (width / cols);
+            int y = (i / cols) * (height / rows);
+            ids[i] = memewm_window_create("tiled", x, y, w > 1 ? w : 1, h > 1 ? h : 1);
+        }
+    } else if (!strcmp(pattern, "random")) {
+        for (int i = 0; i < count; i++) {
+            int ww = w / 2 + rng() % w;
+            int wh = h / 2 + rng() % h;
+            ids[i] = memewm_window_create("random", (int)(rng() % width) - ww / 4,
+                                          (int)(rng() % height) - wh / 4, ww, wh);
+        }
+    } else {
+        /* the stacked windows of the test kernel, continued down the screen */
+        for (int i = 0; i < count; i++) {
+            int x = 30 + (i * 20) % (width - w);
+            int y = 30 + (i * 20) % (height - h);
+            ids[i] = memewm_window_create("cascade", x, y, w, h);
+        }
+    }
+
+    for (int i = 0; i < count; i++)
+        memwm_make_window_toggle_drawable(ids[i]);
+
+    memewm_refresh();
+}
+
+static int random_window(void) {
+    return ids[rng() % id_count];
+}
+
+static int top_window(void) {
+    /* creation focuses, and the benches below never reorder for long */
+    return ids[id_count - 1];
+}
+
+static void refresh_untimed(void) {
+    memewm_stats_t before, after;
+
+    memewm_get_stats(&before);
+    memewm_refresh();
+    memewm_get_stats(&after);
+
+    untimed_stats.damaged_px += after.damaged_px - before.damaged_px;
+    untimed_stats.covered_px += after.covered_px - before.covered_px;
+    untimed_stats.painted_px += after.painted_px - before.painted_px;
+}
+
+/* each bench runs n operations and returns the nanoseconds spent inside
+   the call being measured, setup for the next operation is not counted */
+
+static uint64_t bench_plot_px(size_t n) {
+    int id = top_window();
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < n; i++)
+        memewm_window_plot_px(rng() % 64, rng() % 64, rng(), id);
+    uint64_t elapsed = now_ns() - start;
+    refresh_untimed();
+    return elapsed;
+}
+
+static uint64_t bench_fill_rect(size_t n) {
+    int id = top_window();
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < n; i++)
+        memewm_window_fill_rect(rng() % 64, rng() % 64, 64, 64, rng(), id);
+    uint64_t elapsed = now_ns() - start;
+    refresh_untimed();
+    return elapsed;
+}
+
+/* a client pushing whole frames, clipped to the window */
+static uint64_t bench_blit(size_t n) {
+    static uint32_t frame[256 * 256];
+    int id = top_window();
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < n; i++)
+        memewm_window_blit(0, 0, 256, 256, frame, 256 * sizeof(uint32_t), id);
+    uint64_t elapsed = now_ns() - start;
+    refresh_untimed();
+    return elapsed;
+}
+
+/* a line of a terminal-style window */
+static uint64_t bench_draw_text(size_t n) {
+    static const char line[] = "the quick brown fox jumps over the lazy dog 0123456789 !?";
+    int id = top_window();
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < n; i++)
+        memewm_window_draw_text(0, (i % 4) * 16, line, 0xffffff, 0, id);
+    uint64_t elapsed = now_ns() - start;
+    refresh_untimed();
+    return elapsed;
+}
+
+static uint64_t bench_move(size_t n) {
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < n; i++)
+        memewm_window_move((i & 1) ? -1 : 1, 0, random_window());
+    uint64_t elapsed = now_ns() - start;
+    refresh_untimed();
+    return elapsed;
+}
+
+static uint64_t bench_resize(size_t n) {
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < n; i++)
+        memewm_window_resize((i & 1) ? -1 : 1, (i & 1) ? -1 : 1, top_window());
+    uint64_t elapsed = now_ns() - start;
+    refresh_untimed();
+    return elapsed;
+}
+
+static uint64_t bench_click(size_t n) {
+    volatile int sink = 0;
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < n; i++)
+        sink += memewm_window_click(rng() % width, rng() % height).id;
+    (void)sink;
+    return now_ns() - start;
+}
+
+static uint64_t bench_refresh_plot(size_t n) {
+    uint64_t elapsed = 0;
+    int id = top_window();
+    for (size_t i = 0; i < n; i++) {
+        memewm_window_plot_px(rng() % 64, rng() % 64, rng(), id);
+        uint64_t start = now_ns();
+        memewm_refresh();
+        elapsed += now_ns() - start;
+    }
+    return elapsed;
+}
+
+static uint64_t bench_refresh_move(size_t n) {
+    uint64_t elapsed = 0;
+    int id = top_window();
+    for (size_t i = 0; i < n; i++) {
+        memewm_window_move((i & 1) ? -1 : 1, 0, id);
+        uint64_t start = now_ns();
+        memewm_refresh();
+        elapsed += now_ns() - start;
+    }
+    return elapsed;
+}
+
+static uint64_t bench_refresh_focus(size_t n) {
+    uint64_t elapsed = 0;
+    for (size_t i = 0; i < n; i++) {
+        memewm_window_focus(random_window());
+        uint64_t start = now_ns();
+        memewm_refresh();
+        elapsed += now_ns() - start;
+    }
+    memewm_window_focus(top_window());
+    refresh_untimed();
+    return elapsed;
+}
+
+/* the top window half see-through, moving so everything under it is
+   blended again every frame */
+static uint64_t bench_refresh_translucent(size_t n) {
+    uint64_t elapsed = 0;
+    int id = top_window();
+    memewm_window_set_opacity(128, id);
+    for (size_t i = 0; i < n; i++) {
+        memewm_window_move((i & 1) ? -1 : 1, 0, id);
+        uint64_t start = now_ns();
+        memewm_refresh();
+        elapsed += now_ns() - start;
+    }
+    memewm_window_set_opacity(255, id);
+    refresh_untimed();
+    return elapsed;
+}
+
+/* the overview up, one window drawn to per frame so only its
+   thumbnail has to catch up */
+static uint64_t bench_refresh_overview(size_t n) {
+    uint64_t elapsed = 0;
+    memewm_set_overview(1);
+    refresh_untimed();
+    for (size_t i = 0; i < n; i++) {
+        memewm_window_fill_rect(rng() % 64, rng() % 64, 16, 16, rng(), random_window());
+        uint64_t start = now_ns();
+        memewm_refresh();
+        elapsed += now_ns() - start;
+    }
+    memewm_set_overview(0);
+    refresh_untimed();
+    return elapsed;
+}
+
+typedef struct {
+    const char *name;
+    uint64_t (*run)(size_t);
+} bench_t;
+
+static const bench_t benches[] = {
+    {"plot_px", bench_plot_px},
+    {"fill_rect", bench_fill_rect},
+    {"blit", bench_blit},
+    {"draw_text", bench_draw_text},
+    {"move", bench_move},
+    {"resize", bench_resize},
+    {"click", bench_click},
+    {"refresh_plot", bench_refresh_plot},
+    {"refresh_move", bench_refresh_move},
+    {"refresh_focus", bench_refresh_focus},
+    {"refresh_translucent", bench_refresh_translucent},
+    {"refresh_overview", bench_refresh_overview},
+};
+
+static void run_config(resolution_t res, int count, const char *pattern) {
+    width = res.width;
+    height = res.height;
+    rng_state = 12345;
+
+    if (headless_init(width, height, 0)) {
+        fprintf(stderr, "bench: cannot set up %dx%d\n", width, height);
+        exit(1);
+    }
+
+    create_windows(pattern, count);
+
+    for (size_t i = 0; i < ARRAY_SIZE(benches); i++) {
+        if (filter && !strstr(benches[i].name, filter))
+            continue;
+
+        memewm_stats_t stats;
+        size_t n = 1;
+        size_t total_n = 0;
+        uint64_t total_ns = 0;
+
+        memewm_reset_stats();
+        untimed_stats = (memewm_stats_t){0};
+
+        /* double the batch until the time budget is used up */
+        while (total_ns < budget_ns) {
+            total_ns += benches[i].run(n);
+            total_n += n;
+            n *= 2;
+        }
+
+        memewm_get_stats(&stats);
+        stats.damaged_px -= untimed_stats.damaged_px;
+        stats.covered_px -= untimed_stats.covered_px;
+        stats.painted_px -= untimed_stats.painted_px;
+
+        printf("%s,%d,%d,%d,%s,%zu,%.1f,%.1f,%.1f,%.1f\n", benches[i].name, width, height,
+               count, pattern, total_n, (double)total_ns / total_n,
+               (double)stats.damaged_px / total_n, (double)stats.covered_px / total_n,
+               (double)stats.painted_px / total_n);
+        fflush(stdout);
+    }
+
+    exit(0);
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: bench [-q] [bench name filter]\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    int opt;
+
+    while ((opt = getopt(argc, argv, "q")) != -1) {
+        switch (opt) {
+            case 'q':
+                budget_ns = 20000000;
+                break;
+            default:
+                usage();
+        }
+    }
+
+    if (optind < argc)
+        filter = argv[optind];
+
+    /* one csv row per bench and configuration, times in nanoseconds,
+       pixel columns are per operation and only move for the refresh benches */
+    printf("bench,width,height,windows,pattern,iterations,ns_per_op,damaged_px_per_op,covered_px_per_op,painted_px_per_op\n");
+    fflush(stdout);
+
+    for (size_t r = 0; r < ARRAY_SIZE(resolutions); r++) {
+        for (size_t c = 0; c < ARRAY_SIZE(window_counts); c++) {
+            for (size_t p = 0; p < ARRAY_SIZE(patterns); p++) {
+                pid_t pid = fork();
+                if (pid < 0) {
+                    perror("bench: fork");
+                    return 1;
+                }
+                if (!pid)
+                    run_config(resolutions[r], window_counts[c], patterns[p]);
+
+                int status;
+                waitpid(pid, &status, 0);
+                if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+                    fprintf(stderr, "bench: %dx%d %d %s failed\n", resolutions[r].width,
+                            resolutions[r].height, window_counts[c], patterns[p]);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include <stdlib.h>
+#include "memewm_glue.h"
+
+void *memewm_malloc(size_t size) {
+    return malloc(size);
+}
+
+void *memewm_calloc(size_t count, size_t size) {
+    return calloc(count, size);
+}
+
+void *memewm_realloc(void *addr, size_t size) {
+    return realloc(addr, size);
+}
+
+void *memewm_aligned_alloc(size_t alignment, size_t size) {
+    return aligned_alloc(alignment, size);
+}
+
+void memewm_free(void *addr) {
+    free(addr);
+}
+
+#ifdef MEMEWM_PARALLEL
+
+#include <pthread.h>
+#include <unistd.h>
+
+/* a fixed pool of helper threads started on first use, the caller of
+   memewm_parallel_run takes items off the same queue as they do */
+/* MEMEWM_THREADS overrides the count, one core per thread otherwise */
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER;
+
+static int pool_workers = 0;
+static void (*pool_fn)(void *, int);
+static void *pool_arg;
+static int pool_count = 0;
+static int pool_next = 0;
+static int pool_pending = 0;
+
+/* runs items until the queue is empty, called and returns with pool_lock held */
+static void pool_drain(void) {
+    while (pool_next < pool_count) {
+        int i = pool_next++;
+        void (*fn)(void *, int) = pool_fn;
+        void *arg = pool_arg;
+
+        pthread_mutex_unlock(&pool_lock);
+        fn(arg, i);
+        pthread_mutex_lock(&pool_lock);
+
+        if (!--pool_pending)
+            pthread_cond_signal(&pool_done);
+    }
+}
+
+static void *pool_thread(void *unused) {
+    (void)unused;
+
+    pthread_mutex_lock(&pool_lock);
+    for (;;) {
+        while (pool_next >= pool_count)
+            pthread_cond_wait(&pool_work, &pool_lock);
+        pool_drain();
+    }
+
+    return NULL;
+}
+
+int memewm_parallel_workers(void) {
+    if (pool_workers)
+        return pool_workers;
+
+    const char *env = getenv("MEMEWM_THREADS");
+    long count = env ? atol(env) : sysconf(_SC_NPROCESSORS_ONLN);
+    if (count < 1)
+        count = 1;
+
+    pool_workers = 1;
+    for (long i = 1; i < count; i++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, pool_thread, NULL))
+            break;
+        pthread_detach(thread);
+        pool_workers++;
+    }
+
+    return pool_workers;
+}
+
+void memewm_parallel_run(void (*fn)(void *, int), void *arg, int count) {
+    pthread_mutex_lock(&pool_lock);
+
+    pool_fn = fn;
+    pool_arg = arg;
+    pool_count = count;
+    pool_next = 0;
+    pool_pending = count;
+    pthread_cond_broadcast(&pool_work);
+
+    pool_drain();
+    while (pool_pending)
+        pthread_cond_wait(&pool_done, &pool_lock);
+
+    pthread_mutex_unlock(&pool_lock);
+}
+
+#endif
@@ -0,0 +1,117 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "memewm.h"
+#include "headless.h"
+
+extern uint8_t font[];
+
+/* the buffer on screen, one of buffers[] */
+static uint32_t *framebuffer;
+static uint32_t *buffers[2];
+static int fb_width;
+static int fb_height;
+static int fb_pitch;
+
+static int alloc_buffers(int count, int width, int height, int pitch) {
+    for (int i = 0; i < count; i++) {
+        buffers[i] = calloc((size_t)pitch * height, 1);
+        if (!buffers[i])
+            return -1;
+    }
+
+    framebuffer = buffers[0];
+    fb_width = width;
+    fb_height = height;
+    fb_pitch = pitch;
+
+    return 0;
+}
+
+int headless_init(int width, int height, int pitch) {
+    if (!pitch)
+        pitch = width * sizeof(uint32_t);
+
+    if (alloc_buffers(1, width, height, pitch))
+        return -1;
+
+    return memewm_init(framebuffer, width, height, pitch, font, 8, 16);
+}
+
+static void flip(void *ctx, int index) {
+    (void)ctx;
+
+    framebuffer = buffers[index];
+}
+
+int headless_init_flip(int width, int height, int pitch) {
+    if (!pitch)
+        pitch = width * sizeof(uint32_t);
+
+    if (alloc_buffers(2, width, height, pitch))
+        return -1;
+
+    memewm_backend_t backend = {2, {buffers[0], buffers[1]}, flip, NULL, MEMEWM_FORMAT_XRGB8888};
+
+    return memewm_init_backend(&backend, width, height, pitch, font, 8, 16);
+}
+
+int headless_width(void) {
+    return fb_width;
+}
+
+int headless_height(void) {
+    return fb_height;
+}
+
+static uint32_t *row_at(int y) {
+    return framebuffer + (size_t)(fb_pitch / sizeof(uint32_t)) * y;
+}
+
+uint32_t headless_get_px(int x, int y) {
+    return row_at(y)[x];
+}
+
+uint64_t headless_hash(void) {
+    uint64_t hash = 0xcbf29ce484222325;
+
+    for (int y = 0; y < fb_height; y++) {
+        uint32_t *row = row_at(y);
+        for (int x = 0; x < fb_width; x++) {
+            hash ^= row[x];
+            hash *= 0x100000001b3;
+        }
+    }
+
+    return hash;
+}
+
+int headless_dump(const char *path, int format) {
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return -1;
+
+    if (format == HEADLESS_PPM)
+        fprintf(f, "P6\n%d %d\n255\n", fb_width, fb_height);
+
+    for (int y = 0; y < fb_height; y++) {
+        uint32_t *row = row_at(y);
+
+        if (format == HEADLESS_RAW) {
+            fwrite(row, sizeof(uint32_t), fb_width, f);
+            continue;
+        }
+
+        for (int x = 0; x < fb_width; x++) {
+            uint8_t rgb[3] = {row[x] >> 16, row[x] >> 8, row[x]};
+            fwrite(rgb, 1, 3, f);
+        }
+    }
+
+    if (fclose(f))
+        return -1;
+
+    return 0;
+}
@@ -0,0 +1,29 @@
+#ifndef __HEADLESS_H__
+#define __HEADLESS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* offscreen front-end, memewm composites into a plain malloc'd buffer */
+
+enum {
+    HEADLESS_PPM,   /* binary P6, 8 bits per channel */
+    HEADLESS_RAW    /* width * height XRGB8888 words, no header or padding */
+};
+
+/* pitch is in bytes, 0 picks width * 4 */
+int headless_init(int width, int height, int pitch);
+/* same, but memewm flips between two buffers instead of copying damage */
+/* the screen then only changes on memewm_refresh */
+int headless_init_flip(int width, int height, int pitch);
+
+int headless_width(void);
+int headless_height(void);
+uint32_t headless_get_px(int x, int y);
+
+/* fnv-1a over the visible pixels, padding beyond the width is ignored */
+uint64_t headless_hash(void);
+
+int headless_dump(const char *path, int format);
+
+#endif
@@ -0,0 +1,268 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/wait.h>
+
+#include "memewm.h"
+#include "headless.h"
+
+/* replays scripted sessions through the headless front-end and checks
+   every frame against a manifest recorded from a known good build */
+
+/* regress record DIR   writes DIR/<scene>.txt plus checkpoint frames */
+/* regress check DIR    replays, dumps the first frame that differs */
+/* regress -f check DIR replays through page flipping, where the screen
+                        only changes on a refresh, so only frames right
+                        after one are compared */
+
+typedef struct {
+    const char *name;
+    int width;
+    int height;
+    int pitch;
+    int windows;
+    int steps;
+    uint32_t seed;
+} scene_t;
+
+static const scene_t scenes[] = {
+    {"stack", 1024, 768, 1024 * 4, 4, 400, 1},
+    {"busy", 640, 480, (640 + 24) * 4, 12, 600, 7},
+    {"hd", 1920, 1080, 1920 * 4, 6, 300, 3},
+    {"tiny", 300, 200, (300 + 8) * 4, 8, 500, 9},
+};
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+/* a frame is also written out every this many steps when recording */
+#define CHECKPOINT_STEPS 100
+
+static const char *op_names[] = {
+    "move", "resize", "focus", "plot_px", "cursor", "cursor_abs", "click", "jump", "toggle_drawable"
+};
+
+static uint32_t rng_state;
+
+static int rng(int n) {
+    rng_state = rng_state * 1103515245 + 12345;
+    return (int)((rng_state >> 8) % (uint32_t)n);
+}
+
+static int ids[64];
+
+static int flipping = 0;
+static int refreshed;
+
+static void setup(const scene_t *scene) {
+    int w = scene->width;
+    int h = scene->height;
+
+    if (!strcmp(scene->name, "stack")) {
+        /* the layout the test kernel boots into */
+        for (int i = 0; i < scene->windows; i++) {
+            char title[16];
+            snprintf(title, sizeof(title), "test%d", i + 1);
+            ids[i] = memewm_window_create(title, 30 + i * 20, 30 + i * 20, 800, 400);
+        }
+    } else {
+        for (int i = 0; i < scene->windows; i++) {
+            char title[64];
+            snprintf(title, sizeof(title), "window number %d with long title", i);
+            ids[i] = memewm_window_create(title, rng(w) - 100, rng(h) - 50, 1 + rng(500), 1 + rng(300));
+            if (i % 2)
+                memwm_make_window_toggle_drawable(ids[i]);
+        }
+    }
+
+    memewm_refresh();
+
+    return;
+}
+
+/* runs one random operation, refreshing after most of them */
+static int step(const scene_t *scene) {
+    int op = rng(ARRAY_SIZE(op_names));
+    int window = ids[rng(scene->windows)];
+    int skip_refresh = rng(4) == 0;
+
+    switch (op) {
+        case 0:
+            memewm_window_move(rng(41) - 20, rng(41) - 20, window);
+            break;
+        case 1:
+            memewm_window_resize(rng(41) - 20, rng(41) - 20, window);
+            break;
+        case 2:
+            memewm_window_focus(window);
+            break;
+        case 3:
+            for (int i = 0; i < 30; i++)
+                memewm_window_plot_px(rng(520) - 10, rng(320) - 10, rng_state, window);
+            break;
+        case 4:
+            memewm_set_cursor_pos(rng(81) - 40, rng(81) - 40);
+            break;
+        case 5:
+            memewm_set_cursor_pos_abs(rng(scene->width + 40) - 20, rng(scene->height + 40) - 20);
+            break;
+        case 6:
+            memewm_window_click(rng(scene->width), rng(scene->height));
+            break;
+        case 7:
+            memewm_window_move(rng(801) - 400, rng(601) - 300, window);
+            break;
+        case 8:
+            memwm_make_window_toggle_drawable(window);
+            break;
+    }
+
+    if (!skip_refresh)
+        memewm_refresh();
+    refreshed = !skip_refresh;
+
+    return op;
+}
+
+static void frame_path(char *buf, size_t size, const char *dir, const char *scene,
+                       int step, const char *suffix) {
+    snprintf(buf, size, "%s/%s-%04d%s.ppm", dir, scene, step, suffix);
+
+    return;
+}
+
+static int record(const scene_t *scene, const char *dir) {
+    char path[4096];
+
+    snprintf(path, sizeof(path), "%s/%s.txt", dir, scene->name);
+    FILE *manifest = fopen(path, "w");
+    if (!manifest) {
+        perror(path);
+        return 1;
+    }
+
+    for (int i = 0; i <= scene->steps; i++) {
+        if (i)
+            step(scene);
+
+        fprintf(manifest, "%d %016llx\n", i, (unsigned long long)headless_hash());
+
+        if (i % CHECKPOINT_STEPS == 0 || i == scene->steps) {
+            frame_path(path, sizeof(path), dir, scene->name, i, "");
+            if (headless_dump(path, HEADLESS_PPM)) {
+                perror(path);
+                return 1;
+            }
+        }
+    }
+
+    fclose(manifest);
+
+    printf("%s: recorded %d frames\n", scene->name, scene->steps + 1);
+
+    return 0;
+}
+
+static int check(const scene_t *scene, const char *dir) {
+    char path[4096];
+
+    snprintf(path, sizeof(path), "%s/%s.txt", dir, scene->name);
+    FILE *manifest = fopen(path, "r");
+    if (!manifest) {
+        perror(path);
+        return 1;
+    }
+
+    int op = -1;
+
+    for (int i = 0; i <= scene->steps; i++) {
+        int expected_step;
+        unsigned long long expected_hash;
+
+        if (i)
+            op = step(scene);
+
+        if (fscanf(manifest, "%d %llx", &expected_step, &expected_hash) != 2
+            || expected_step != i) {
+            fprintf(stderr, "%s: manifest ends or is out of order at step %d\n", scene->name, i);
+            return 1;
+        }
+
+        if (flipping && i && !refreshed)
+            continue;
+
+        if (headless_hash() != expected_hash) {
+            frame_path(path, sizeof(path), dir, scene->name, i, ".fail");
+            headless_dump(path, HEADLESS_PPM);
+            printf("%s: frame %d differs after %s, wrote %s\n", scene->name, i,
+                   op == -1 ? "setup" : op_names[op], path);
+            return 1;
+        }
+    }
+
+    fclose(manifest);
+
+    printf("%s: %d frames match\n", scene->name, scene->steps + 1);
+
+    return 0;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: regress record|check DIR\n       regress -f check DIR\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    if (argc == 4 && !strcmp(argv[1], "-f")) {
+        flipping = 1;
+        argc--;
+        argv++;
+    }
+
+    if (argc != 3)
+        usage();
+
+    int recording = !strcmp(argv[1], "record");
+    if (!recording && strcmp(argv[1], "check"))
+        usage();
+
+    /* a recording has to see every step */
+    if (recording && flipping)
+        usage();
+
+    int failed = 0;
+
+    for (size_t i = 0; i < ARRAY_SIZE(scenes); i++) {
+        const scene_t *scene = &scenes[i];
+
+        fflush(stdout);
+
+        /* memewm keeps its state in globals, one process per scene */
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("regress: fork");
+            return 1;
+        }
+
+        if (!pid) {
+            rng_state = scene->seed;
+            if ((flipping ? headless_init_flip : headless_init)(scene->width, scene->height,
+                                                               scene->pitch)) {
+                fprintf(stderr, "%s: cannot set up the headless screen\n", scene->name);
+                exit(1);
+            }
+            setup(scene);
+            exit(recording ? record(scene, argv[2]) : check(scene, argv[2]));
+        }
+
+        int status;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status))
+            failed++;
+    }
+
+    return failed ? 1 : 0;
+}
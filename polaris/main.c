@@ -8,10 +8,12 @@
 
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <poll.h>
 #include <sys/utsname.h>
 #include <sys/sysinfo.h>
 
 #include <errno.h>
+#include <signal.h>
 #include <time.h>
 
 #include <linux/fb.h>
@@ -22,6 +24,8 @@
 
 
 #include "../src/memewm.h"
+#include "memewm_proto.h"
+#include "server.h"
 
 uint8_t font[];
 
@@ -29,44 +33,273 @@ void *memewm_malloc(size_t size) {
 	return malloc(size);
 }
 
+void *memewm_calloc(size_t count, size_t size) {
+	return calloc(count, size);
+}
+
+void *memewm_realloc(void *addr, size_t size) {
+	return realloc(addr, size);
+}
+
+void *memewm_aligned_alloc(size_t alignment, size_t size) {
+	return aligned_alloc(alignment, size);
+}
+
 void memewm_free(void *addr) {
 	free(addr);
 }
 
+#ifdef MEMEWM_PARALLEL
+
+#include <pthread.h>
+
+// helper threads started on first use, the compositor thread takes
+// bands off the same queue as they do
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER;
+
+static int pool_workers = 0;
+static void (*pool_fn)(void *, int);
+static void *pool_arg;
+static int pool_count = 0;
+static int pool_next = 0;
+static int pool_pending = 0;
+
+// runs items until the queue is empty, called with pool_lock held
+static void pool_drain(void) {
+	while (pool_next < pool_count) {
+		int i = pool_next++;
+		void (*fn)(void *, int) = pool_fn;
+		void *arg = pool_arg;
+
+		pthread_mutex_unlock(&pool_lock);
+		fn(arg, i);
+		pthread_mutex_lock(&pool_lock);
+
+		if (!--pool_pending)
+			pthread_cond_signal(&pool_done);
+	}
+}
+
+static void *pool_thread(void *unused) {
+	(void)unused;
+
+	pthread_mutex_lock(&pool_lock);
+	for (;;) {
+		while (pool_next >= pool_count)
+			pthread_cond_wait(&pool_work, &pool_lock);
+		pool_drain();
+	}
+
+	return NULL;
+}
+
+int memewm_parallel_workers(void) {
+	if (pool_workers)
+		return pool_workers;
+
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+	pool_workers = 1;
+	for (long i = 1; i < count; i++) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, pool_thread, NULL))
+			break;
+		pthread_detach(thread);
+		pool_workers++;
+	}
+
+	return pool_workers;
+}
+
+void memewm_parallel_run(void (*fn)(void *, int), void *arg, int count) {
+	pthread_mutex_lock(&pool_lock);
+
+	pool_fn = fn;
+	pool_arg = arg;
+	pool_count = count;
+	pool_next = 0;
+	pool_pending = count;
+	pthread_cond_broadcast(&pool_work);
+
+	pool_drain();
+	while (pool_pending)
+		pthread_cond_wait(&pool_done, &pool_lock);
+
+	pthread_mutex_unlock(&pool_lock);
+}
+
+#endif
+
+struct flip_state {
+	int fd;
+	struct fb_var_screeninfo var;
+	int can_wait;
+};
+
+// shows the buffer memewm just drew, a screen below the other one
+static void fb_flip(void *ctx, int index) {
+	struct flip_state *state = ctx;
+
+#ifdef FBIO_WAITFORVSYNC
+	// switch on the vertical blank so the new frame does not tear
+	if (state->can_wait) {
+		uint32_t crtc = 0;
+		if (ioctl(state->fd, FBIO_WAITFORVSYNC, &crtc) < 0)
+			state->can_wait = 0;
+	}
+#endif
+
+	state->var.yoffset = index * state->var.yres;
+	ioctl(state->fd, FBIOPAN_DISPLAY, &state->var);
+}
+
 struct mouse_packet {
 	uint8_t flags;
 	int32_t x_mov;
 	int32_t y_mov;
 };
 
-static void window_putc(char c, int x, int y, int window_handle) {
-	x *= 8;
-	y *= 16;
-	uint8_t line;
-	for (uint32_t x_bit = 0; x_bit < 16; x_bit++) {
-		line = font[c * 16 + x_bit];
-		for (uint32_t y_bit = 0; y_bit <= 8; y_bit++) {
-			if (line & (1 << (8 - y_bit - 1))) {
-				memewm_window_plot_px(x + y_bit, y + x_bit, 0xFFFFFF, window_handle);
-			} else if (c == ' ') {
-				memewm_window_plot_px(x + y_bit, y + x_bit, 0x000000, window_handle);
-			}
+// frames are composited at most this often, input in between is batched
+#define FRAME_INTERVAL_NS (1000000000 / 60)
+#define MAX_PACKETS 64
+
+static int64_t packet_x_mov(struct mouse_packet *packet) {
+	if (packet->flags & (1 << 4))
+		return (int8_t)packet->x_mov;
+	return packet->x_mov;
+}
+
+static int64_t packet_y_mov(struct mouse_packet *packet) {
+	if (packet->flags & (1 << 5))
+		return (int8_t)packet->y_mov;
+	return packet->y_mov;
+}
+
+static uint64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// the right button brings the overview up and takes it down again
+static int overview;
+
+static void toggle_overview(void) {
+	overview = !overview;
+	memewm_set_overview(overview);
+}
+
+// applies one motion, which may stand for several packets
+static void handle_mouse(int64_t x_mov, int64_t y_mov, int clicked) {
+	int last_x = 0, last_y = 0, new_x = 0, new_y = 0;
+
+	// a click in the overview picks the window to go back to
+	if (overview) {
+		memewm_set_cursor_pos(x_mov, -y_mov);
+		if (!clicked)
+			return;
+		memewm_get_cursor_pos(&new_x, &new_y);
+		int id = memewm_overview_window_at(new_x, new_y);
+		if (id != -1) {
+			memewm_window_focus(id);
+			toggle_overview();
+		}
+		return;
+	}
+
+	memewm_get_cursor_pos(&last_x, &last_y);
+	window_click_data_t last_click_data =
+	memewm_window_click(last_x, last_y);
+	memewm_set_cursor_pos(x_mov, -y_mov);
+	memewm_get_cursor_pos(&new_x, &new_y);
+
+	window_click_data_t new_click_data = memewm_window_click(new_x, new_y);
+	if (new_click_data.rel_x != -1 && new_click_data.rel_y != -1)
+		server_pointer(new_click_data.id, new_click_data.rel_x,
+					new_click_data.rel_y, clicked);
+
+	// there was a click!!!
+	if (!clicked)
+		return;
+
+	int id = last_click_data.id;
+
+	if (last_click_data.top_border) {
+		memewm_window_focus(id);
+		memewm_window_resize(0, -(new_y - last_y), id);
+		memewm_window_move(0, new_y - last_y, id);
+	}
+
+	if (last_click_data.bottom_border) {
+		memewm_window_focus(id);
+		memewm_window_resize(0, new_y - last_y, id);
+	}
+
+	if (last_click_data.left_border) {
+		memewm_window_focus(id);
+		memewm_window_resize(-(new_x - last_x), 0, id);
+		memewm_window_move(new_x - last_x, 0, id);
+	}
+
+	if (last_click_data.right_border) {
+		memewm_window_focus(id);
+		memewm_window_resize(new_x - last_x, 0, id);
+	}
+
+	if (last_click_data.titlebar) {
+		memewm_window_focus(id);
+		memewm_window_move(new_x - last_x, new_y - last_y, id);
+	}
+
+	if (last_click_data.rel_x != -1 &&
+		last_click_data.rel_y != -1) {
+		memewm_window_focus(id);
+		// client windows draw themselves
+		if (server_owns_window(id))
+			return;
+		// dab along the whole motion so batched strokes stay solid
+		int dx = new_x - last_x, dy = new_y - last_y;
+		int steps = abs(dx) > abs(dy) ? abs(dx) : abs(dy);
+		for (int i = 0; i < (steps ? steps : 1); i++) {
+			memewm_window_fill_rect(last_click_data.rel_x + (steps ? dx * i / steps : 0),
+							last_click_data.rel_y + (steps ? dy * i / steps : 0),
+							10, 10, 0xffffff, id);
 		}
 	}
 }
 
-static void window_puts(char *str, int x, int y, int window_handle) {
-	while (*str) {
-		window_putc(*str++, x++, y, window_handle);
+// works out the MEMEWM_FORMAT_* of the screen, -1 if memewm cannot draw it
+static int screen_format(struct fb_var_screeninfo *var) {
+	// red in the low bits is the bgr order
+	int bgr = var->red.offset == 0;
+
+	switch (var->bits_per_pixel) {
+		case 32:
+			return bgr ? MEMEWM_FORMAT_XBGR8888 : MEMEWM_FORMAT_XRGB8888;
+		case 24:
+			return bgr ? MEMEWM_FORMAT_BGR888 : MEMEWM_FORMAT_RGB888;
+		case 16:
+			// 15 bit screens say 16 too
+			if (var->green.length != 6)
+				return -1;
+			return bgr ? MEMEWM_FORMAT_BGR565 : MEMEWM_FORMAT_RGB565;
+		default:
+			return -1;
 	}
 }
 
-int main(void) {
+int main(int argc, char **argv) {
 	printf("MEME :^)\n");
-	struct mouse_packet mouse_pack = {0};
 	struct fb_fix_screeninfo fix = {0};
 	struct fb_var_screeninfo var = {0};
 
+	// -s [path] serves clients on a unix socket besides the built in windows
+	const char *socket_path = NULL;
+	if (argc > 1 && !strcmp(argv[1], "-s"))
+		socket_path = argc > 2 ? argv[2] : MEMEWM_SOCKET_PATH;
+
 	int mouse_fd = open("/dev/mouse", O_RDONLY);
 	if (mouse_fd == -1) {
 		printf("[!] Failed to find mouse device\n");
@@ -90,12 +323,66 @@ int main(void) {
 		return -1;
 	}
 
-	uint32_t *fb = mmap(0,
-						fix.line_length * var.yres,
-					 PROT_READ | PROT_WRITE, MAP_SHARED, framebuffer_fd, 0);
+	int format = screen_format(&var);
+	if (format == -1) {
+		printf("[!] Unsupported framebuffer format, %u bpp\n", var.bits_per_pixel);
+		return -1;
+	}
+
+	// flip between two screens when the device has room for them and
+	// can pan, copy the damage into a single one otherwise
+	// flipped frames are drawn in place, so only at memewm's own format
+	static struct flip_state flip_state = {0};
+	flip_state.fd = framebuffer_fd;
+	flip_state.var = var;
+	flip_state.var.xoffset = 0;
+	flip_state.var.yoffset = 0;
+	flip_state.can_wait = 1;
+
+	int buffer_count = 1;
+	if (format == MEMEWM_FORMAT_XRGB8888 && var.yres_virtual >= 2 * var.yres &&
+		ioctl(framebuffer_fd, FBIOPAN_DISPLAY, &flip_state.var) == 0)
+		buffer_count = 2;
+
+	size_t screen_size = (size_t)fix.line_length * var.yres;
+	uint32_t *fb = mmap(NULL, screen_size * buffer_count,
+						PROT_READ | PROT_WRITE, MAP_SHARED, framebuffer_fd, 0);
+
+	// the device may not map both screens, one is enough to copy into
+	if (fb == MAP_FAILED && buffer_count == 2) {
+		buffer_count = 1;
+		fb = mmap(NULL, screen_size, PROT_READ | PROT_WRITE, MAP_SHARED, framebuffer_fd, 0);
+	}
+
+	if (fb == MAP_FAILED) {
+		printf("[!] Failed to map framebuffer\n");
+		return -1;
+	}
+
+	int ret = -1;
+	if (buffer_count == 2) {
+		memewm_backend_t backend = {
+			2, {fb, fb + fix.line_length / sizeof(uint32_t) * var.yres},
+			fb_flip, &flip_state, format
+		};
+		ret = memewm_init_backend(&backend, var.xres, var.yres,
+					fix.line_length, font, 8, 16);
+	}
+
+	// the first screen of a flipping mapping does for copying too
+	if (ret < 0) {
+		// the fbdev mapping is write-combining, so stream whole vectors into it
+		memewm_set_nontemporal_present(1);
+
+		memewm_backend_t backend = {1, {fb, NULL}, NULL, NULL, format};
+		ret = memewm_init_backend(&backend, var.xres, var.yres,
+					fix.line_length, font, 8, 16);
+	}
 
-	memewm_init(fb, var.xres, var.yres,
-				fix.line_length, font, 8, 16);
+	if (ret < 0) {
+		printf("[!] Failed to set up memewm\n");
+		return -1;
+	}
 
 	struct utsname uname_buffer = {0};
 
@@ -120,75 +407,80 @@ int main(void) {
 #endif
 
 	snprintf(buffer, 128, "%s running on %s!", uname_buffer.sysname, p);
-	window_puts(buffer, 1, 0, sysinfo_window_handle);
 	memwm_make_window_toggle_drawable(sysinfo_window_handle);
+	memewm_window_draw_text(8, 0, buffer, 0xFFFFFF, 0x000000, sysinfo_window_handle);
 
 	memewm_window_create("Chalkboard", 30, 30, 800, 400);
 	memewm_refresh();
-	for (;;) {
-		if (read(mouse_fd, &mouse_pack, sizeof(struct mouse_packet)) > 0) {
-			int last_x = 0, last_y = 0, new_x = 0, new_y = 0;
-			int64_t x_mov = 0, y_mov = 0;
-			if (mouse_pack.flags & (1 << 4)) {
-				x_mov = (int8_t)mouse_pack.x_mov;
-			} else
-				x_mov = mouse_pack.x_mov;
-
-			if (mouse_pack.flags & (1 << 5)) {
-				y_mov = (int8_t)mouse_pack.y_mov;
-			} else
-				y_mov = mouse_pack.y_mov;
-
-			memewm_get_cursor_pos(&last_x, &last_y);
-			window_click_data_t last_click_data =
-			memewm_window_click(last_x, last_y);
-			memewm_set_cursor_pos(x_mov, -y_mov);
-			// there was a click!!!
-			if ((mouse_pack.flags & (1 << 0))) {
-				memewm_get_cursor_pos(&new_x, &new_y);
-
-				int id = last_click_data.id;
-
-				if (last_click_data.top_border) {
-					memewm_window_focus(id);
-					memewm_window_resize(0, -(new_y - last_y), id);
-					memewm_window_move(0, new_y - last_y, id);
-				}
 
-				if (last_click_data.bottom_border) {
-					memewm_window_focus(id);
-					memewm_window_resize(0, new_y - last_y, id);
-				}
+	if (socket_path) {
+		// a client going away mid write must not take the compositor along
+		signal(SIGPIPE, SIG_IGN);
+		if (server_init(socket_path) < 0) {
+			printf("[!] Failed to listen on %s\n", socket_path);
+			return -1;
+		}
+	}
 
-				if (last_click_data.left_border) {
-					memewm_window_focus(id);
-					memewm_window_resize(-(new_x - last_x), 0, id);
-					memewm_window_move(new_x - last_x, 0, id);
-				}
+	// the mouse comes first, then whatever the server waits on
+	struct pollfd fds[1 + SERVER_MAX_FDS];
+	struct mouse_packet packets[MAX_PACKETS];
+	uint64_t next_frame = 0;
+	int dirty = 0;
+	int right_held = 0;
 
-				if (last_click_data.right_border) {
-					memewm_window_focus(id);
-					memewm_window_resize(new_x - last_x, 0, id);
-				}
+	for (;;) {
+		// sleep until input arrives, or until the next frame is due
+		// when there is something to show
+		int timeout = -1;
+		if (dirty) {
+			uint64_t now = now_ns();
+			timeout = now >= next_frame ? 0 : (next_frame - now + 999999) / 1000000;
+		}
 
-				if (last_click_data.titlebar) {
-					memewm_window_focus(id);
-					memewm_window_move(new_x - last_x, new_y - last_y, id);
+		fds[0] = (struct pollfd){mouse_fd, POLLIN, 0};
+		int server_fds = server_poll_fds(fds + 1);
+
+		if (poll(fds, 1 + server_fds, timeout) <= 0)
+			server_fds = 0;
+
+		// commits that come in before the frame is due land in it together
+		if (server_dispatch(fds + 1, server_fds))
+			dirty = 1;
+
+		if (fds[0].revents & POLLIN) {
+			ssize_t n = read(mouse_fd, packets, sizeof(packets));
+			int count = n > 0 ? n / sizeof(struct mouse_packet) : 0;
+
+			// runs of packets with the same button state collapse
+			// into a single motion
+			for (int i = 0; i < count;) {
+				int buttons = packets[i].flags & 3;
+				int clicked = buttons & (1 << 0);
+				int right = buttons & (1 << 1);
+				int64_t x_mov = 0, y_mov = 0;
+				for (; i < count && (packets[i].flags & 3) == buttons; i++) {
+					x_mov += packet_x_mov(&packets[i]);
+					y_mov += packet_y_mov(&packets[i]);
 				}
-
-				if (last_click_data.rel_x != -1 &&
-					last_click_data.rel_y != -1) {
-					memewm_window_focus(id);
-					for (int i = 0; i < 10; i++) {
-						for (int j = 0; j < 10; j++) {
-							memewm_window_plot_px(last_click_data.rel_x + i,
-									  		last_click_data.rel_y + j, 0xffffff, id);
-						}
-					}
-					}
-					memewm_refresh();
+				// a right button press switches before the motion made with it
+				if (right && !right_held)
+					toggle_overview();
+				right_held = right;
+				handle_mouse(x_mov, y_mov, clicked);
+				dirty = 1;
 			}
 		}
+
+		// a flipped screen only shows the cursor move once refreshed
+		uint64_t now = now_ns();
+		if (dirty && now >= next_frame) {
+			server_check_surfaces();
+			memewm_refresh();
+			server_frame_done();
+			next_frame = now + FRAME_INTERVAL_NS;
+			dirty = 0;
+		}
 	}
 
 	return 0;
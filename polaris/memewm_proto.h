@@ -0,0 +1,120 @@
+#ifndef __MEMEWM_PROTO_H__
+#define __MEMEWM_PROTO_H__
+
+#include <stdint.h>
+
+// wire format between meme -s and its clients over a unix stream socket
+// every message starts with a header, length counts the whole message,
+// integers are in host order since both ends share the machine
+
+#define MEMEWM_SOCKET_PATH "/tmp/memewm.sock"
+
+// no message is longer than this, the server drops clients that send one
+#define MEMEWM_MSG_MAX 1024
+
+struct memewm_msg_header {
+	uint16_t type;
+	uint16_t length;
+};
+
+// requests, client to server
+
+// window handles are picked by the client, so requests can be sent
+// back to back without waiting for replies
+
+enum {
+	MEMEWM_REQ_CREATE = 1,
+	MEMEWM_REQ_ATTACH,
+	MEMEWM_REQ_COMMIT,
+	MEMEWM_REQ_SUBSCRIBE,
+	MEMEWM_REQ_DESTROY,
+};
+
+// the title follows, up to the end of the message
+// nothing shows up until a surface is attached
+struct memewm_req_create {
+	struct memewm_msg_header header;
+	uint32_t window;
+	int32_t x;
+	int32_t y;
+	uint32_t width;
+	uint32_t height;
+};
+
+// the shm_open name of the surface follows, up to the end of the message
+// rows of pitch bytes, at least width * 4, and at least height of them
+// the server maps it read only and keeps it until the window is
+// destroyed, unlinking the name is left to the client, the first frame
+// event shows the server has it open
+// a window is attached once, its size can then change within the surface
+// a surface truncated below pitch * rows is taken off with an error
+// event, the window can then be attached again
+struct memewm_req_attach {
+	struct memewm_msg_header header;
+	uint32_t window;
+	uint32_t pitch;
+	uint32_t rows;
+};
+
+struct memewm_rect {
+	int16_t x;
+	int16_t y;
+	uint16_t width;
+	uint16_t height;
+};
+
+// the parts of the surface that changed since the last commit, as many
+// rects as fit in the message follow
+// they show up with the next frame, which is announced with a
+// MEMEWM_EV_FRAME once on screen
+struct memewm_req_commit {
+	struct memewm_msg_header header;
+	uint32_t window;
+};
+
+#define MEMEWM_INPUT_POINTER (1 << 0)
+
+// replaces the set of MEMEWM_INPUT_* the window gets events for
+struct memewm_req_subscribe {
+	struct memewm_msg_header header;
+	uint32_t window;
+	uint32_t events;
+};
+
+struct memewm_req_destroy {
+	struct memewm_msg_header header;
+	uint32_t window;
+};
+
+// events, server to client
+
+enum {
+	MEMEWM_EV_FRAME = 1,
+	MEMEWM_EV_POINTER,
+	MEMEWM_EV_ERROR,
+};
+
+// the last commit is on screen, a good time to draw the next one
+struct memewm_ev_frame {
+	struct memewm_msg_header header;
+	uint32_t window;
+};
+
+// the pointer moved or its buttons changed over the window's surface
+struct memewm_ev_pointer {
+	struct memewm_msg_header header;
+	uint32_t window;
+	int32_t x;
+	int32_t y;
+	uint32_t buttons;
+};
+
+// a request for the window could not be carried out
+struct memewm_ev_error {
+	struct memewm_msg_header header;
+	uint32_t window;
+	uint16_t request;
+	uint16_t error;
+};
+
+#endif
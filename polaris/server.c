@@ -0,0 +1,562 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <poll.h>
+
+#include "../src/memewm.h"
+#include "memewm_proto.h"
+#include "server.h"
+
+#define MAX_CLIENT_WINDOWS 16
+#define MAX_TITLE 64
+// events a client has not read yet, one that falls this far behind is dropped
+#define CLIENT_OUT_MAX (16 * MEMEWM_MSG_MAX)
+
+struct client_window {
+	int used;
+	uint32_t handle;
+	// -1 until a surface is attached
+	int id;
+	char title[MAX_TITLE];
+	int x;
+	int y;
+	uint32_t width;
+	uint32_t height;
+	void *surface;
+	size_t surface_size;
+	// kept open to see whether the client shrank the surface
+	int surface_fd;
+	uint32_t events;
+	// a commit waits for a frame event
+	int frame_pending;
+};
+
+struct client {
+	int fd;
+	uint8_t in[2 * MEMEWM_MSG_MAX];
+	size_t in_length;
+	uint8_t out[CLIENT_OUT_MAX];
+	size_t out_length;
+	// dropped on the next dispatch, events can be sent from anywhere
+	int broken;
+	struct client_window windows[MAX_CLIENT_WINDOWS];
+};
+
+static int listen_fd = -1;
+static struct client clients[SERVER_MAX_CLIENTS];
+static int client_count = 0;
+
+int server_init(const char *path) {
+	struct sockaddr_un addr = {0};
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+
+	listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listen_fd < 0)
+		return -1;
+
+	// a socket left behind by an earlier run would make bind fail
+	unlink(path);
+
+	if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+		listen(listen_fd, 8) < 0) {
+		close(listen_fd);
+		listen_fd = -1;
+		return -1;
+	}
+
+	fcntl(listen_fd, F_SETFL, O_NONBLOCK);
+
+	return 0;
+}
+
+// writes out as much of the client's queue as the socket takes
+// returns -1 if the client is gone
+static int flush_client(struct client *client) {
+	size_t off = 0;
+
+	while (off < client->out_length) {
+		ssize_t n = write(client->fd, client->out + off, client->out_length - off);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && errno == EAGAIN)
+			break;
+		if (n <= 0)
+			return -1;
+		off += n;
+	}
+
+	memmove(client->out, client->out + off, client->out_length - off);
+	client->out_length -= off;
+
+	return 0;
+}
+
+// client sockets do not block, so events go through a queue that is
+// flushed when poll says there is room again, a client that lets it
+// fill up is cut off rather than stalling the compositor or losing
+// events, a lost frame event would leave it waiting forever
+static void send_event(struct client *client, const void *event, size_t length) {
+	if (client->broken)
+		return;
+
+	if (client->out_length + length <= sizeof(client->out)) {
+		memcpy(client->out + client->out_length, event, length);
+		client->out_length += length;
+		if (flush_client(client) == 0)
+			return;
+	}
+
+	client->broken = 1;
+	// poll then reports a hangup, so the dispatch that drops it comes soon
+	shutdown(client->fd, SHUT_RDWR);
+}
+
+static void send_error(struct client *client, uint32_t handle, uint16_t request, int error) {
+	struct memewm_ev_error event = {
+		{MEMEWM_EV_ERROR, sizeof(event)}, handle, request, error
+	};
+
+	send_event(client, &event, sizeof(event));
+}
+
+static struct client_window *find_window(struct client *client, uint32_t handle) {
+	for (int i = 0; i < MAX_CLIENT_WINDOWS; i++) {
+		if (client->windows[i].used && client->windows[i].handle == handle)
+			return &client->windows[i];
+	}
+
+	return NULL;
+}
+
+static void detach_surface(struct client_window *window) {
+	if (window->id != -1)
+		memewm_window_destroy(window->id);
+	if (window->surface) {
+		munmap(window->surface, window->surface_size);
+		close(window->surface_fd);
+	}
+
+	window->id = -1;
+	window->surface = NULL;
+	window->surface_size = 0;
+	window->frame_pending = 0;
+}
+
+// pages a client truncated away fault when memewm reads them, a
+// surface that no longer covers what was attached is taken off
+// returns nonzero if it was
+static int check_surface(struct client *client, struct client_window *window) {
+	struct stat st;
+
+	if (!window->surface)
+		return 0;
+	if (fstat(window->surface_fd, &st) == 0 && (size_t)st.st_size >= window->surface_size)
+		return 0;
+
+	detach_surface(window);
+	send_error(client, window->handle, MEMEWM_REQ_ATTACH, EFAULT);
+
+	return 1;
+}
+
+static void destroy_window(struct client_window *window) {
+	detach_surface(window);
+
+	memset(window, 0, sizeof(*window));
+}
+
+static void drop_client(int index) {
+	struct client *client = &clients[index];
+
+	for (int i = 0; i < MAX_CLIENT_WINDOWS; i++) {
+		if (client->windows[i].used)
+			destroy_window(&client->windows[i]);
+	}
+
+	close(client->fd);
+
+	clients[index] = clients[--client_count];
+}
+
+static int handle_create(struct client *client, const uint8_t *msg, size_t length) {
+	struct memewm_req_create req;
+
+	if (length < sizeof(req))
+		return -1;
+	memcpy(&req, msg, sizeof(req));
+
+	if (find_window(client, req.window)) {
+		send_error(client, req.window, req.header.type, EEXIST);
+		return 0;
+	}
+
+	struct client_window *window = NULL;
+	for (int i = 0; i < MAX_CLIENT_WINDOWS && !window; i++) {
+		if (!client->windows[i].used)
+			window = &client->windows[i];
+	}
+
+	if (!window) {
+		send_error(client, req.window, req.header.type, ENOSPC);
+		return 0;
+	}
+
+	size_t title_length = length - sizeof(req);
+	if (title_length >= MAX_TITLE)
+		title_length = MAX_TITLE - 1;
+
+	window->used = 1;
+	window->handle = req.window;
+	window->id = -1;
+	memcpy(window->title, msg + sizeof(req), title_length);
+	window->title[title_length] = 0;
+	window->x = req.x;
+	window->y = req.y;
+	window->width = req.width;
+	window->height = req.height;
+
+	return 0;
+}
+
+static int handle_attach(struct client *client, const uint8_t *msg, size_t length) {
+	struct memewm_req_attach req;
+	char name[NAME_MAX + 1];
+
+	if (length < sizeof(req) || length - sizeof(req) > NAME_MAX)
+		return -1;
+	memcpy(&req, msg, sizeof(req));
+	memcpy(name, msg + sizeof(req), length - sizeof(req));
+	name[length - sizeof(req)] = 0;
+
+	struct client_window *window = find_window(client, req.window);
+	if (!window || window->id != -1) {
+		send_error(client, req.window, req.header.type, window ? EEXIST : ENOENT);
+		return 0;
+	}
+
+	if (req.pitch % 4 || req.pitch / 4 < window->width || req.rows < window->height) {
+		send_error(client, req.window, req.header.type, EINVAL);
+		return 0;
+	}
+
+	// the name is the client's, it unlinks it once attached
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0) {
+		send_error(client, req.window, req.header.type, errno);
+		return 0;
+	}
+
+	// a surface shorter than it claims would fault on the first refresh
+	struct stat st;
+	size_t size = (size_t)req.pitch * req.rows;
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size < size || !size) {
+		close(fd);
+		send_error(client, req.window, req.header.type, EINVAL);
+		return 0;
+	}
+
+	void *surface = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (surface == MAP_FAILED) {
+		close(fd);
+		send_error(client, req.window, req.header.type, errno);
+		return 0;
+	}
+
+	// memewm only reads a client's surface, the windows are never
+	// made drawable
+	int id = memewm_window_create_with_buffer(window->title, window->x, window->y,
+						window->width, window->height,
+						surface, req.pitch, 0);
+	if (id == -1) {
+		munmap(surface, size);
+		close(fd);
+		send_error(client, req.window, req.header.type, ENOMEM);
+		return 0;
+	}
+
+	window->id = id;
+	window->surface = surface;
+	window->surface_size = size;
+	window->surface_fd = fd;
+
+	return 1;
+}
+
+static int handle_commit(struct client *client, const uint8_t *msg, size_t length) {
+	struct memewm_req_commit req;
+
+	if (length < sizeof(req))
+		return -1;
+	memcpy(&req, msg, sizeof(req));
+
+	struct client_window *window = find_window(client, req.window);
+	if (!window || window->id == -1) {
+		send_error(client, req.window, req.header.type, ENOENT);
+		return 0;
+	}
+
+	if (check_surface(client, window))
+		return 1;
+
+	for (size_t off = sizeof(req); off + sizeof(struct memewm_rect) <= length;
+		off += sizeof(struct memewm_rect)) {
+		struct memewm_rect rect;
+		memcpy(&rect, msg + off, sizeof(rect));
+		memewm_window_damage(rect.x, rect.y, rect.width, rect.height, window->id);
+	}
+
+	window->frame_pending = 1;
+
+	return 1;
+}
+
+static int handle_subscribe(struct client *client, const uint8_t *msg, size_t length) {
+	struct memewm_req_subscribe req;
+
+	if (length < sizeof(req))
+		return -1;
+	memcpy(&req, msg, sizeof(req));
+
+	struct client_window *window = find_window(client, req.window);
+	if (!window) {
+		send_error(client, req.window, req.header.type, ENOENT);
+		return 0;
+	}
+
+	window->events = req.events;
+
+	return 0;
+}
+
+static int handle_destroy(struct client *client, const uint8_t *msg, size_t length) {
+	struct memewm_req_destroy req;
+
+	if (length < sizeof(req))
+		return -1;
+	memcpy(&req, msg, sizeof(req));
+
+	struct client_window *window = find_window(client, req.window);
+	if (!window) {
+		send_error(client, req.window, req.header.type, ENOENT);
+		return 0;
+	}
+
+	int shown = window->id != -1;
+	destroy_window(window);
+
+	return shown;
+}
+
+// runs every whole message in the client's buffer
+// returns -1 when the client broke the protocol, otherwise nonzero
+// when the screen changed
+static int handle_messages(struct client *client) {
+	size_t off = 0;
+	int dirty = 0;
+
+	while (client->in_length - off >= sizeof(struct memewm_msg_header)) {
+		struct memewm_msg_header header;
+		memcpy(&header, client->in + off, sizeof(header));
+
+		if (header.length < sizeof(header) || header.length > MEMEWM_MSG_MAX)
+			return -1;
+		if (client->in_length - off < header.length)
+			break;
+
+		const uint8_t *msg = client->in + off;
+		int ret;
+
+		switch (header.type) {
+			case MEMEWM_REQ_CREATE:
+				ret = handle_create(client, msg, header.length);
+				break;
+			case MEMEWM_REQ_ATTACH:
+				ret = handle_attach(client, msg, header.length);
+				break;
+			case MEMEWM_REQ_COMMIT:
+				ret = handle_commit(client, msg, header.length);
+				break;
+			case MEMEWM_REQ_SUBSCRIBE:
+				ret = handle_subscribe(client, msg, header.length);
+				break;
+			case MEMEWM_REQ_DESTROY:
+				ret = handle_destroy(client, msg, header.length);
+				break;
+			default:
+				ret = -1;
+		}
+
+		if (ret < 0)
+			return -1;
+		dirty |= ret;
+
+		off += header.length;
+	}
+
+	// keep the start of a message that has not fully arrived
+	memmove(client->in, client->in + off, client->in_length - off);
+	client->in_length -= off;
+
+	return dirty;
+}
+
+static void accept_clients(void) {
+	for (;;) {
+		int fd = accept(listen_fd, NULL, NULL);
+		if (fd < 0)
+			return;
+
+		if (client_count == SERVER_MAX_CLIENTS) {
+			close(fd);
+			continue;
+		}
+
+		fcntl(fd, F_SETFL, O_NONBLOCK);
+
+		struct client *client = &clients[client_count++];
+		memset(client, 0, sizeof(*client));
+		client->fd = fd;
+	}
+}
+
+int server_poll_fds(struct pollfd *fds) {
+	if (listen_fd < 0)
+		return 0;
+
+	fds[0] = (struct pollfd){listen_fd, POLLIN, 0};
+	for (int i = 0; i < client_count; i++) {
+		short events = clients[i].out_length ? POLLIN | POLLOUT : POLLIN;
+		fds[1 + i] = (struct pollfd){clients[i].fd, events, 0};
+	}
+
+	return 1 + client_count;
+}
+
+int server_dispatch(struct pollfd *fds, int count) {
+	int dirty = 0;
+
+	if (!count)
+		return 0;
+
+	// walk the clients back to front, dropping one moves the last into its place
+	for (int i = count - 2; i >= 0; i--) {
+		struct client *client = &clients[i];
+
+		if (client->broken ||
+			((fds[1 + i].revents & POLLOUT) && flush_client(client) < 0)) {
+			drop_client(i);
+			dirty = 1;
+			continue;
+		}
+
+		if (!(fds[1 + i].revents & (POLLIN | POLLHUP | POLLERR)))
+			continue;
+
+		// a batch of commits from one client is applied in one go
+		ssize_t n = read(client->fd, client->in + client->in_length,
+				sizeof(client->in) - client->in_length);
+		if (n < 0 && (errno == EAGAIN || errno == EINTR))
+			continue;
+
+		int ret = -1;
+		if (n > 0) {
+			client->in_length += n;
+			ret = handle_messages(client);
+		}
+
+		if (ret < 0) {
+			drop_client(i);
+			dirty = 1;
+			continue;
+		}
+		dirty |= ret;
+	}
+
+	// clients accepted now are polled from the next round on
+	if (fds[0].revents & POLLIN)
+		accept_clients();
+
+	return dirty;
+}
+
+int server_check_surfaces(void) {
+	int dirty = 0;
+
+	for (int i = 0; i < client_count; i++) {
+		for (int j = 0; j < MAX_CLIENT_WINDOWS; j++) {
+			if (clients[i].windows[j].used)
+				dirty |= check_surface(&clients[i], &clients[i].windows[j]);
+		}
+	}
+
+	return dirty;
+}
+
+void server_frame_done(void) {
+	for (int i = 0; i < client_count; i++) {
+		for (int j = 0; j < MAX_CLIENT_WINDOWS; j++) {
+			struct client_window *window = &clients[i].windows[j];
+
+			if (!window->used || !window->frame_pending)
+				continue;
+
+			struct memewm_ev_frame event = {
+				{MEMEWM_EV_FRAME, sizeof(event)}, window->handle
+			};
+			send_event(&clients[i], &event, sizeof(event));
+			window->frame_pending = 0;
+		}
+	}
+}
+
+static struct client_window *find_client_window(int id, struct client **owner) {
+	if (id == -1)
+		return NULL;
+
+	for (int i = 0; i < client_count; i++) {
+		for (int j = 0; j < MAX_CLIENT_WINDOWS; j++) {
+			if (clients[i].windows[j].used && clients[i].windows[j].id == id) {
+				*owner = &clients[i];
+				return &clients[i].windows[j];
+			}
+		}
+	}
+
+	return NULL;
+}
+
+int server_owns_window(int window) {
+	struct client *owner;
+
+	return find_client_window(window, &owner) != NULL;
+}
+
+void server_pointer(int window, int x, int y, int buttons) {
+	struct client *owner;
+	struct client_window *client_window = find_client_window(window, &owner);
+
+	if (!client_window || !(client_window->events & MEMEWM_INPUT_POINTER))
+		return;
+
+	struct memewm_ev_pointer event = {
+		{MEMEWM_EV_POINTER, sizeof(event)}, client_window->handle, x, y, buttons
+	};
+	send_event(owner, &event, sizeof(event));
+}
@@ -0,0 +1,36 @@
+#ifndef __SERVER_H__
+#define __SERVER_H__
+
+#include <poll.h>
+
+// clients beyond this are turned away
+#define SERVER_MAX_CLIENTS 32
+// pollfds server_poll_fds may fill in
+#define SERVER_MAX_FDS (1 + SERVER_MAX_CLIENTS)
+
+// listens on path for clients speaking memewm_proto.h
+int server_init(const char *path);
+
+// fills in what the server waits on, returns how many
+int server_poll_fds(struct pollfd *fds);
+
+// handles what poll reported on the fds server_poll_fds filled in
+// returns nonzero when the screen needs a refresh
+int server_dispatch(struct pollfd *fds, int count);
+
+// takes off client surfaces that shrank below what was attached, they
+// would fault memewm, call before each refresh
+// returns nonzero when the screen changed
+int server_check_surfaces(void);
+
+// tells clients whose commits the last refresh showed
+void server_frame_done(void);
+
+// whether a client draws the window, memewm must not then
+int server_owns_window(int window);
+
+// passes the pointer on to the client of window if it asked for it,
+// x and y are relative to the window's surface
+void server_pointer(int window, int x, int y, int buttons);
+
+#endif
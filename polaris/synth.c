@@ -0,0 +1,258 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "memewm_proto.h"
+
+// synthetic clients for meme -s, each process opens a window, sweeps a
+// bar across it and commits once per frame event
+
+// synth [-n clients] [-f frames] [-s socket path]
+
+#define WIDTH 240
+#define HEIGHT 160
+#define BAR_WIDTH 16
+
+static uint64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int send_all(int fd, const void *buf, size_t length) {
+	const uint8_t *p = buf;
+
+	while (length) {
+		ssize_t n = write(fd, p, length);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return -1;
+		p += n;
+		length -= n;
+	}
+
+	return 0;
+}
+
+// sends a fixed part followed by a string, the way create and attach are laid out
+static int send_with_string(int fd, void *msg, size_t size, const char *str) {
+	uint8_t buf[MEMEWM_MSG_MAX];
+	size_t length = strlen(str);
+
+	if (size + length > sizeof(buf))
+		return -1;
+
+	((struct memewm_msg_header *)msg)->length = size + length;
+	memcpy(buf, msg, size);
+	memcpy(buf + size, str, length);
+
+	return send_all(fd, buf, size + length);
+}
+
+static void fill(uint32_t *surface, int x0, int x1, uint32_t colour) {
+	for (int y = 0; y < HEIGHT; y++) {
+		for (int x = x0; x < x1; x++)
+			surface[y * WIDTH + x] = colour;
+	}
+}
+
+static int run_client(const char *path, int index, int frames) {
+	struct sockaddr_un addr = {0};
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		perror("synth: connect");
+		return 1;
+	}
+
+	char name[64];
+	snprintf(name, sizeof(name), "/memewm-synth-%d", (int)getpid());
+
+	int shm = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (shm < 0 || ftruncate(shm, WIDTH * HEIGHT * 4) < 0) {
+		perror("synth: shm");
+		return 1;
+	}
+
+	uint32_t *surface = mmap(NULL, WIDTH * HEIGHT * 4, PROT_READ | PROT_WRITE,
+							MAP_SHARED, shm, 0);
+	close(shm);
+	if (surface == MAP_FAILED) {
+		perror("synth: mmap");
+		shm_unlink(name);
+		return 1;
+	}
+
+	uint32_t background = 0x203040 + index * 0x100810;
+	fill(surface, 0, WIDTH, background);
+
+	char title[32];
+	snprintf(title, sizeof(title), "synth %d", index);
+
+	struct memewm_req_create create = {
+		{MEMEWM_REQ_CREATE, 0}, 1, 40 + index * 30, 40 + index * 30, WIDTH, HEIGHT
+	};
+	struct memewm_req_attach attach = {
+		{MEMEWM_REQ_ATTACH, 0}, 1, WIDTH * 4, HEIGHT
+	};
+	struct memewm_req_subscribe subscribe = {
+		{MEMEWM_REQ_SUBSCRIBE, sizeof(subscribe)}, 1, MEMEWM_INPUT_POINTER
+	};
+
+	// everything up to the first frame goes out back to back
+	if (send_with_string(fd, &create, sizeof(create), title) ||
+		send_with_string(fd, &attach, sizeof(attach), name) ||
+		send_all(fd, &subscribe, sizeof(subscribe))) {
+		perror("synth: send");
+		shm_unlink(name);
+		return 1;
+	}
+
+	struct {
+		struct memewm_req_commit commit;
+		struct memewm_rect rects[2];
+	} commit = {{{MEMEWM_REQ_COMMIT, sizeof(commit)}, 1}, {{0}}};
+
+	// events that have arrived, the last may not have fully
+	uint8_t in[2 * MEMEWM_MSG_MAX];
+	size_t in_length = 0;
+
+	uint64_t start = now_ns();
+	int bar = 0;
+	int frame = 0;
+	int pointer_events = 0;
+	int waiting = 0;
+
+	while (frame < frames) {
+		if (!waiting) {
+			// the old bar and the new one are the only pixels that change
+			int next = (bar + 4) % (WIDTH - BAR_WIDTH);
+			fill(surface, bar, bar + BAR_WIDTH, background);
+			fill(surface, next, next + BAR_WIDTH, 0xffffff);
+
+			commit.rects[0] = (struct memewm_rect){bar, 0, BAR_WIDTH, HEIGHT};
+			commit.rects[1] = (struct memewm_rect){next, 0, BAR_WIDTH, HEIGHT};
+			bar = next;
+
+			if (send_all(fd, &commit, sizeof(commit))) {
+				perror("synth: send");
+				shm_unlink(name);
+				return 1;
+			}
+			waiting = 1;
+		}
+
+		ssize_t n = read(fd, in + in_length, sizeof(in) - in_length);
+		if (n <= 0) {
+			fprintf(stderr, "synth %d: server went away\n", index);
+			shm_unlink(name);
+			return 1;
+		}
+		in_length += n;
+
+		// a read can end anywhere in the stream, the start of an event
+		// that has not fully arrived is kept for the next one
+		size_t off = 0;
+		while (in_length - off >= sizeof(struct memewm_msg_header)) {
+			struct memewm_msg_header header;
+			memcpy(&header, in + off, sizeof(header));
+			if (header.length < sizeof(header) || header.length > MEMEWM_MSG_MAX) {
+				fprintf(stderr, "synth %d: bad event from the server\n", index);
+				shm_unlink(name);
+				return 1;
+			}
+			if (in_length - off < header.length)
+				break;
+
+			if (header.type == MEMEWM_EV_FRAME) {
+				// the server has the surface open by now
+				if (!frame)
+					shm_unlink(name);
+				frame++;
+				waiting = 0;
+			} else if (header.type == MEMEWM_EV_POINTER) {
+				pointer_events++;
+			} else if (header.type == MEMEWM_EV_ERROR) {
+				struct memewm_ev_error error;
+				memcpy(&error, in + off, sizeof(error));
+				fprintf(stderr, "synth %d: request %d failed: %s\n", index,
+						error.request, strerror(error.error));
+				shm_unlink(name);
+				return 1;
+			}
+
+			off += header.length;
+		}
+
+		memmove(in, in + off, in_length - off);
+		in_length -= off;
+	}
+
+	double seconds = (now_ns() - start) / 1e9;
+	printf("synth %d: %d frames in %.2f s, %.1f fps, %d pointer events\n",
+			index, frames, seconds, frames / seconds, pointer_events);
+
+	struct memewm_req_destroy destroy = {{MEMEWM_REQ_DESTROY, sizeof(destroy)}, 1};
+	send_all(fd, &destroy, sizeof(destroy));
+	close(fd);
+
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	const char *path = MEMEWM_SOCKET_PATH;
+	int clients = 4;
+	int frames = 300;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:f:s:")) != -1) {
+		switch (opt) {
+			case 'n':
+				clients = atoi(optarg);
+				break;
+			case 'f':
+				frames = atoi(optarg);
+				break;
+			case 's':
+				path = optarg;
+				break;
+			default:
+				fprintf(stderr, "usage: synth [-n clients] [-f frames] [-s socket path]\n");
+				return 1;
+		}
+	}
+
+	for (int i = 0; i < clients; i++) {
+		pid_t pid = fork();
+		if (pid < 0) {
+			perror("synth: fork");
+			return 1;
+		}
+		if (!pid)
+			exit(run_client(path, i, frames));
+	}
+
+	int failed = 0;
+	for (int i = 0; i < clients; i++) {
+		int status;
+		wait(&status);
+		if (!WIFEXITED(status) || WEXITSTATUS(status))
+			failed++;
+	}
+
+	return failed ? 1 : 0;
+}
@@ -3,6 +3,16 @@
 #include <stdbool.h>
 #include "memewm.h"
 #include "memewm_glue.h"
+#include "memewm_pixel.h"
+#include "memewm_alloc.h"
+
+/* half-open screen rectangle: [x0, x1) x [y0, y1) */
+typedef struct {
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+} rect_t;
 
 typedef struct window_t {
     int id;
@@ -13,72 +23,238 @@ typedef struct window_t {
     int y_size;
     bool is_drawable;
     uint32_t *framebuffer;
+    int stride;             /* pixels from one row of framebuffer to the next */
+    size_t capacity;        /* pixels allocated, at least stride * y_size */
+    int alpha;              /* opacity of the whole window, 255 unless made translucent */
+    bool surface_alpha;     /* the top byte of every surface pixel is its alpha */
+    bool client_buffer;     /* framebuffer was handed in by the client */
+    bool owns_buffer;       /* and is freed on destroy, pooled surfaces always are */
+    uint32_t *decorations;  /* the title bar rows of the frame, borders included */
+    size_t decorations_capacity;
+    int decorations_width;  /* frame width the decorations were rendered for */
+    int decorations_glyphs; /* title glyphs they show */
+    uint32_t *thumbnail;    /* the surface box filtered down by 1 << thumbnail_shift */
+    size_t thumbnail_capacity;
+    int thumbnail_shift;
+    int thumbnail_width;
+    int thumbnail_height;
+    rect_t thumbnail_stale; /* surface area drawn to since the thumbnail was brought up to date */
+    rect_t overview_rect;   /* where the overview shows the thumbnail, border included */
     struct window_t *next;
+    struct window_t *prev;
+    uint64_t z;             /* grows with every raise, the top has the highest */
+    rect_t grid_cells;      /* hit-test grid cells the window is filed under */
 } window_t;
 
+#define CURSOR_SIZE 16
+
+/* bit 15 of a row is its leftmost pixel */
 typedef struct {
-    int64_t bitmap[16 * 16];
+    uint16_t mask[CURSOR_SIZE];     /* pixels that belong to the cursor */
+    uint16_t colour[CURSOR_SIZE];   /* picks palette[1] over palette[0] */
+    uint32_t palette[2];
 } cursor_t;
 
-#define X 0x00ffffff
-#define B 0x00000000
-#define o (-1)
-
 static cursor_t cursor = {
     {
-        X, X, X, X, X, X, X, X, X, X, X, X, o, o, o, o,
-        X, B, B, B, B, B, B, B, B, B, X, o, o, o, o, o,
-        X, B, B, B, B, B, B, B, B, X, o, o, o, o, o, o,
-        X, B, B, B, B, B, B, B, X, o, o, o, o, o, o, o,
-        X, B, B, B, B, B, B, X, o, o, o, o, o, o, o, o,
-        X, B, B, B, B, B, B, B, X, o, o, o, o, o, o, o,
-        X, B, B, B, B, B, B, B, B, X, o, o, o, o, o, o,
-        X, B, B, B, X, B, B, B, B, B, X, o, o, o, o, o,
-        X, B, B, X, o, X, B, B, B, B, B, X, o, o, o, o,
-        X, B, X, o, o, o, X, B, B, B, B, B, X, o, o, o,
-        X, X, o, o, o, o, o, X, B, B, B, B, B, X, o, o,
-        X, o, o, o, o, o, o, o, X, B, B, B, B, B, X, o,
-        o, o, o, o, o, o, o, o, o, X, B, B, B, B, B, X,
-        o, o, o, o, o, o, o, o, o, o, X, B, B, B, X, o,
-        o, o, o, o, o, o, o, o, o, o, o, X, B, X, o, o,
-        o, o, o, o, o, o, o, o, o, o, o, o, X, o, o, o,
-    }
+        0b1111111111110000,
+        0b1111111111100000,
+        0b1111111111000000,
+        0b1111111110000000,
+        0b1111111100000000,
+        0b1111111110000000,
+        0b1111111111000000,
+        0b1111111111100000,
+        0b1111011111110000,
+        0b1110001111111000,
+        0b1100000111111100,
+        0b1000000011111110,
+        0b0000000001111111,
+        0b0000000000111110,
+        0b0000000000011100,
+        0b0000000000001000,
+    },
+    {
+        0b1111111111110000,
+        0b1000000000100000,
+        0b1000000001000000,
+        0b1000000010000000,
+        0b1000000100000000,
+        0b1000000010000000,
+        0b1000000001000000,
+        0b1000100000100000,
+        0b1001010000010000,
+        0b1010001000001000,
+        0b1100000100000100,
+        0b1000000010000010,
+        0b0000000001000001,
+        0b0000000000100010,
+        0b0000000000010100,
+        0b0000000000001000,
+    },
+    {0x00000000, 0x00ffffff}
 };
 
-#undef X
-#undef B
-#undef o
-
 static int TITLE_BAR_THICKNESS = 18;
 static uint32_t BACKGROUND_COLOUR = 0x00008080;
 static uint32_t WINDOW_BORDERS = 0x00ffffff;
 static uint32_t TITLE_BAR_BACKG = 0x00003377;
 static uint32_t TITLE_BAR_FOREG = 0x00ffffff;
 
-static int memewm_needs_refresh = 0;
 static int memewm_current_window = -1;
 
 static uint32_t *memewm_framebuffer;
 static int memewm_screen_width;
 static int memewm_screen_height;
-static int memewm_screen_pitch;
+static int memewm_screen_pitch;     /* bytes from one screen row to the next */
+static int memewm_screen_bytes;     /* bytes per screen pixel */
+/* pixels from one row of the antibuffer to the next, the screen's own
+   pitch when it is xrgb8888 so both can share indices */
+static size_t scene_pitch;
 
 static uint8_t *memewm_font_bitmap;
 static int memewm_font_width;
 static int memewm_font_height;
 
+/* fonts are one byte per glyph row, so a row can only take 256 shapes */
+/* each cache entry expands all of them for one colour pair */
+#define GLYPH_CACHE_ENTRIES 4
+
+typedef struct {
+    uint32_t fg;
+    uint32_t bg;
+    uint32_t *rows;         /* 256 rows of memewm_font_width pixels, null if unused */
+} glyph_cache_entry_t;
+
+static glyph_cache_entry_t glyph_cache[GLYPH_CACHE_ENTRIES];
+static int glyph_cache_next = 0;
+
 static size_t memewm_fb_size;
 
 static int memewm_mouse_x = 0;
 static int memewm_mouse_y = 0;
 
-static int last_mouse_x = 0;
-static int last_mouse_y = 0;
+/* the cursor is stamped straight into the framebuffer on top of the
+   composited scene, cursor_save holds the scene pixels it covers */
+static uint32_t cursor_save[CURSOR_SIZE * CURSOR_SIZE];
+static int cursor_drawn = 0;
+static int cursor_x;
+static int cursor_y;
 
 static uint32_t *antibuffer;
-static uint32_t *prevbuffer;
 
+/* the copy path presents in tiles, a bit per tile is set when a refresh
+   composites any of it and the runs of set bits in a tile row go to the
+   screen as whole spans */
+#define TILE_SHIFT_X 6
+#define TILE_SHIFT_Y 4
+
+static uint64_t *dirty_tiles;
+static int tile_cols;
+static int tile_rows;
+static int tile_words;      /* words per tile row */
+/* tile rows [dirty_row0, dirty_row1) hold every set bit */
+static int dirty_row0;
+static int dirty_row1;
+
+static memewm_backend_t memewm_backend;
+
+/* back to front, the tail is the focused window */
 static window_t *windows = 0;
+static window_t *windows_tail = 0;
+
+/* window ids index a slot table, the upper bits carry the generation of
+   the slot so an id goes stale once its window is destroyed */
+#define WINDOW_SLOT_BITS 16
+#define WINDOW_SLOT_MASK ((1 << WINDOW_SLOT_BITS) - 1)
+#define WINDOW_GENERATION_MASK 0x7fff
+
+typedef struct {
+    window_t *window;       /* null while the slot is free */
+    int generation;
+    int next_free;
+} window_slot_t;
+
+static uint64_t z_counter = 0;
+
+/* screen-space grid for hit testing, each cell lists every window whose
+   frame reaches into it, in no particular order */
+#define GRID_CELL_SHIFT 6
+
+typedef struct {
+    window_t **windows;
+    int count;
+    int size;
+} grid_cell_t;
+
+static grid_cell_t *grid = 0;
+static int grid_cols;
+static int grid_rows;
+/* cleared if a cell could not grow, hit tests then walk the stack */
+static int grid_valid = 0;
+
+static window_slot_t *window_slots = 0;
+static int window_slots_size = 0;
+static int window_slots_free = -1;
+
+#define MAX_DAMAGE_RECTS 32
+/* undamaged pixels a merge may pull in before two rects are kept apart */
+#define DAMAGE_MERGE_SLACK (64 * 64)
+
+static rect_t damage_rects[MAX_DAMAGE_RECTS];
+static int damage_count = 0;
+
+/* page flipping draws frames straight into the hidden buffer, which
+   then stands in for the antibuffer and the framebuffer both */
+static int flip_front = 0;
+/* damage of the frame on screen, the hidden buffer predates it */
+static rect_t flip_damage[MAX_DAMAGE_RECTS];
+static int flip_damage_count = 0;
+/* where the cursor was stamped into each buffer */
+static rect_t flip_cursor[2];
+
+#define MAX_VISIBLE_RECTS 256
+#define MAX_BLEND_RECTS 256
+
+typedef struct {
+    window_t *window;
+    rect_t r;
+} blend_rect_t;
+
+/* scratch state of one compositing pass over a horizontal band */
+typedef struct {
+    /* the part of a damage rect no window in front has claimed yet */
+    rect_t uncovered[2][MAX_VISIBLE_RECTS];
+    /* translucent windows met on the way, front to back */
+    blend_rect_t blends[MAX_BLEND_RECTS];
+    int blend_count;
+    memewm_stats_t stats;
+} compose_ctx_t;
+
+#ifdef MEMEWM_PARALLEL
+#define MAX_COMPOSE_BANDS 16
+/* below this many damaged pixels handing bands to workers costs more than it saves */
+#define PARALLEL_MIN_PX (256 * 256)
+#else
+#define MAX_COMPOSE_BANDS 1
+#endif
+
+static compose_ctx_t compose_ctx[MAX_COMPOSE_BANDS];
+
+/* band i covers the rows [band_y[i], band_y[i + 1]) */
+static int band_y[MAX_COMPOSE_BANDS + 1];
+
+static memewm_stats_t memewm_stats;
+
+/* the overview shows every window as a thumbnail in a grid of its own
+   instead of the desktop */
+#define OVERVIEW_MARGIN 8
+/* windows too big to fit their cell at this are cut off */
+#define THUMBNAIL_MAX_SHIFT 8
+
+static int overview = 0;
+/* set when windows came, went or changed size since the grid was laid out */
+static int overview_dirty = 0;
 
 static size_t memewm_strlen(const char *str) {
     size_t len;
@@ -98,500 +274,1728 @@ static char *memewm_strcpy(char *dest, const char *src) {
     return dest;
 }
 
-static void *memewm_alloc(size_t size) {
-    uint8_t *ptr = memewm_malloc(size);
-
-    if (!ptr)
-        return (void *)0;
+static int rect_empty(rect_t r) {
+    return r.x0 >= r.x1 || r.y0 >= r.y1;
+}
 
-    for (size_t i = 0; i < size; i++)
-        ptr[i] = 0;
+static size_t rect_area(rect_t r) {
+    if (rect_empty(r))
+        return 0;
 
-    return (void *)ptr;
+    return (size_t)(r.x1 - r.x0) * (size_t)(r.y1 - r.y0);
 }
 
-static void plot_px(int x, int y, uint32_t hex) {
-    if (x >= memewm_screen_width || y >= memewm_screen_height || x < 0 || y < 0)
-        return;
-
-    size_t fb_i = x + (memewm_screen_pitch / sizeof(uint32_t)) * y;
+static rect_t rect_intersect(rect_t a, rect_t b) {
+    rect_t r;
 
-    antibuffer[fb_i] = hex;
+    r.x0 = a.x0 > b.x0 ? a.x0 : b.x0;
+    r.y0 = a.y0 > b.y0 ? a.y0 : b.y0;
+    r.x1 = a.x1 < b.x1 ? a.x1 : b.x1;
+    r.y1 = a.y1 < b.y1 ? a.y1 : b.y1;
 
-    return;
+    return r;
 }
 
-static void plot_px_direct(int x, int y, uint32_t hex) {
-    if (x >= memewm_screen_width || y >= memewm_screen_height || x < 0 || y < 0)
-        return;
+static rect_t rect_union(rect_t a, rect_t b) {
+    rect_t r;
 
-    size_t fb_i = x + (memewm_screen_pitch / sizeof(uint32_t)) * y;
+    r.x0 = a.x0 < b.x0 ? a.x0 : b.x0;
+    r.y0 = a.y0 < b.y0 ? a.y0 : b.y0;
+    r.x1 = a.x1 > b.x1 ? a.x1 : b.x1;
+    r.y1 = a.y1 > b.y1 ? a.y1 : b.y1;
 
-    memewm_framebuffer[fb_i] = hex;
+    return r;
+}
 
-    return;
+static int rect_equal(rect_t a, rect_t b) {
+    return a.x0 == b.x0 && a.y0 == b.y0 && a.x1 == b.x1 && a.y1 == b.y1;
 }
 
-static uint32_t get_px(int x, int y) {
-    if (x >= memewm_screen_width || y >= memewm_screen_height || x < 0 || y < 0)
-        return 0;
+/* the screen area covered by a window, decorations included */
+static rect_t window_frame(window_t *wptr) {
+    rect_t r;
 
-    size_t fb_i = x + (memewm_screen_pitch / sizeof(uint32_t)) * y;
+    r.x0 = wptr->x;
+    r.y0 = wptr->y;
+    r.x1 = wptr->x + wptr->x_size + 2;
+    r.y1 = wptr->y + wptr->y_size + TITLE_BAR_THICKNESS + 1;
 
-    return antibuffer[fb_i];
+    return r;
 }
 
-static void plot_char(char c, int x, int y, uint32_t hex_fg, uint32_t hex_bg) {
-    int orig_x = x;
+/* records a screen area that has to be recomposited on the next refresh */
+static void damage_rect(rect_t r) {
+    rect_t screen = {0, 0, memewm_screen_width, memewm_screen_height};
+
+    r = rect_intersect(r, screen);
+    if (rect_empty(r))
+        return;
 
-    for (int i = 0; i < memewm_font_height; i++) {
-        for (int j = 0; j < memewm_font_width; j++) {
-            if ((memewm_font_bitmap[c * memewm_font_height + i] >> ((memewm_font_width - 1) - j)) & 1)
-                plot_px(x++, y, hex_fg);
-            else
-                plot_px(x++, y, hex_bg);
+    /* fold the new rect into every rect it overlaps or sits close to,
+       a merge grows the rect so the scan restarts after each one */
+    for (int i = 0; i < damage_count; i++) {
+        rect_t u = rect_union(damage_rects[i], r);
+        size_t waste = rect_area(u) - rect_area(damage_rects[i]) - rect_area(r)
+                     + rect_area(rect_intersect(damage_rects[i], r));
+
+        if (waste <= DAMAGE_MERGE_SLACK) {
+            r = u;
+            damage_rects[i] = damage_rects[--damage_count];
+            i = -1;
         }
-        y++;
-        x = orig_x;
     }
 
-    return;
-}
+    if (damage_count == MAX_DAMAGE_RECTS) {
+        /* out of slots, grow whichever rect takes the new one most cheaply */
+        int best = 0;
+        size_t best_growth = (size_t)-1;
 
-static void memewm_update_cursor(void) {
-    for (size_t x = 0; x < 16; x++) {
-        for (size_t y = 0; y < 16; y++) {
-            if (cursor.bitmap[x * 16 + y] != -1) {
-                uint32_t px = get_px(last_mouse_x + x, last_mouse_y + y);
-                plot_px_direct(last_mouse_x + x, last_mouse_y + y, px);
-            }
-        }
-    }
-    for (size_t x = 0; x < 16; x++) {
-        for (size_t y = 0; y < 16; y++) {
-            if (cursor.bitmap[x * 16 + y] != -1) {
-                plot_px_direct(memewm_mouse_x + x, memewm_mouse_y + y, cursor.bitmap[x * 16 + y]);
+        for (int i = 0; i < damage_count; i++) {
+            size_t growth = rect_area(rect_union(damage_rects[i], r)) - rect_area(damage_rects[i]);
+            if (growth < best_growth) {
+                best_growth = growth;
+                best = i;
             }
         }
+
+        damage_rects[best] = rect_union(damage_rects[best], r);
+        return;
     }
-    last_mouse_x = memewm_mouse_x;
-    last_mouse_y = memewm_mouse_y;
+
+    damage_rects[damage_count++] = r;
+
     return;
 }
 
-static window_t *get_window_ptr(int id) {
-    if (!windows) {
-        return (window_t *)0;
-    } else {
-        window_t *wptr = windows;
-        for (;;) {
-            if (wptr->id == id) {
-                return wptr;
-            }
-            if (!wptr->next) {
-                /* not found */
-                return (window_t *)0;
-            } else {
-                wptr = wptr->next;
-            }
-        }
+static void damage_window(window_t *wptr) {
+    /* the desktop is not on screen, only the window's thumbnail is */
+    if (overview)
+        damage_rect(wptr->overview_rect);
+    else
+        damage_rect(window_frame(wptr));
+
+    return;
+}
+
+/* marks a drawn rectangle of a window's surface for the next refresh */
+static void damage_window_area(window_t *wptr, rect_t r) {
+    int sx = wptr->x + 1;
+    int sy = wptr->y + TITLE_BAR_THICKNESS;
+
+    /* thumbnails catch up when they are next shown */
+    if (wptr->thumbnail) {
+        if (rect_empty(wptr->thumbnail_stale))
+            wptr->thumbnail_stale = r;
+        else
+            wptr->thumbnail_stale = rect_union(wptr->thumbnail_stale, r);
     }
+
+    if (!overview)
+        damage_rect((rect_t){sx + r.x0, sy + r.y0, sx + r.x1, sy + r.y1});
+
+    return;
 }
 
-/* creates a new window with a title, size */
-/* returns window id */
-int memewm_window_create(char *title, size_t x, size_t y, size_t x_size, size_t y_size) {
-    window_t *wptr;
-    int id = 0;
+static int grid_init(void) {
+    grid_cols = (memewm_screen_width + (1 << GRID_CELL_SHIFT) - 1) >> GRID_CELL_SHIFT;
+    grid_rows = (memewm_screen_height + (1 << GRID_CELL_SHIFT) - 1) >> GRID_CELL_SHIFT;
 
-    uint32_t *fb = memewm_alloc(x_size * y_size * sizeof(uint32_t));
-    if (!fb)
+    grid = memewm_calloc((size_t)grid_cols * grid_rows, sizeof(grid_cell_t));
+    if (!grid)
         return -1;
 
-    char *wtitle = memewm_alloc(memewm_strlen(title) + 1);
-    if (!title)
-        return -1;
+    grid_valid = 1;
 
-    /* check if no windows were allocated */
-    if (!windows) {
-        /* allocate root window */
-        windows = memewm_alloc(sizeof(window_t));
-        if (!windows)
-            return -1;
-        wptr = windows;
-    } else {
-        /* else crawl the linked list to the last entry */
-        wptr = windows;
-        for (;;) {
-            if (wptr->id == id)
-                id++;
-            if (wptr->next) {
-                wptr = wptr->next;
-                continue;
-            } else {
-                wptr->next = memewm_alloc(sizeof(window_t));
-                if (!wptr->next)
-                    return -1;
-                wptr = wptr->next;
-                break;
-            }
-        }
-    }
+    return 0;
+}
 
-    wptr->id = id;
-    memewm_strcpy(wtitle, title);
-    wptr->title = wtitle;
-    wptr->x = x;
-    wptr->y = y;
-    wptr->x_size = x_size;
-    wptr->y_size = y_size;
-    wptr->framebuffer = fb;
-    wptr->next = 0;
+/* the cells a window's frame covers, clipped to the grid */
+static rect_t grid_cells_of(window_t *wptr) {
+    rect_t screen = {0, 0, memewm_screen_width, memewm_screen_height};
+    rect_t r = rect_intersect(window_frame(wptr), screen);
 
-    memewm_current_window = id;
+    if (rect_empty(r))
+        return (rect_t){0, 0, 0, 0};
 
-    memewm_needs_refresh = 1;
+    r.x0 >>= GRID_CELL_SHIFT;
+    r.y0 >>= GRID_CELL_SHIFT;
+    r.x1 = ((r.x1 - 1) >> GRID_CELL_SHIFT) + 1;
+    r.y1 = ((r.y1 - 1) >> GRID_CELL_SHIFT) + 1;
 
-    return id;
+    return r;
 }
 
-void memewm_window_focus(int window) {
-    /* moves the requested window to the foreground */
-    window_t *last_wptr;
-    window_t *req_wptr = get_window_ptr(window);
-    window_t *prev_wptr;
+static void grid_remove(window_t *wptr) {
+    rect_t c = wptr->grid_cells;
+
+    for (int cy = c.y0; cy < c.y1; cy++) {
+        for (int cx = c.x0; cx < c.x1; cx++) {
+            grid_cell_t *cell = &grid[cy * grid_cols + cx];
+            for (int i = 0; i < cell->count; i++) {
+                if (cell->windows[i] == wptr) {
+                    cell->windows[i] = cell->windows[--cell->count];
+                    break;
+                }
+            }
+        }
+    }
 
-    if (!windows)
-        return;
+    wptr->grid_cells = (rect_t){0, 0, 0, 0};
 
-    if (!req_wptr)
-        return;
+    return;
+}
 
-    window_t *next_wptr = req_wptr->next;
+static int grid_cell_add(grid_cell_t *cell, window_t *wptr) {
+    if (cell->count == cell->size) {
+        int new_size = cell->size ? cell->size * 2 : 4;
 
-    if (!(req_wptr == windows))
-        for (prev_wptr = windows; prev_wptr->next != req_wptr; prev_wptr = prev_wptr->next);
-    else
-        prev_wptr = 0;
+        window_t **new_windows = memewm_realloc(cell->windows, new_size * sizeof(window_t *));
+        if (!new_windows)
+            return -1;
+
+        cell->windows = new_windows;
+        cell->size = new_size;
+    }
+
+    cell->windows[cell->count++] = wptr;
 
-    for (last_wptr = windows; last_wptr->next; last_wptr = last_wptr->next);
+    return 0;
+}
 
-    if (last_wptr == req_wptr)
+/* refiles a window after its geometry changed, a move that stays within
+   the same cells costs nothing */
+static void grid_update(window_t *wptr) {
+    if (!grid_valid)
         return;
 
-    /* all necessary variables acquired */
+    rect_t c = grid_cells_of(wptr);
+    rect_t old = wptr->grid_cells;
 
-    /* the prev should point to the next */
-    if (prev_wptr)
-        prev_wptr->next = next_wptr;
-    else
-        windows = next_wptr;
-    /* the requested one should point to NULL */
-    req_wptr->next = 0;
-    /* the last should point to the requested one */
-    last_wptr->next = req_wptr;
+    if (c.x0 == old.x0 && c.y0 == old.y0 && c.x1 == old.x1 && c.y1 == old.y1)
+        return;
 
-    memewm_current_window = window;
+    grid_remove(wptr);
+
+    for (int cy = c.y0; cy < c.y1; cy++) {
+        for (int cx = c.x0; cx < c.x1; cx++) {
+            if (grid_cell_add(&grid[cy * grid_cols + cx], wptr)) {
+                grid_valid = 0;
+                return;
+            }
+        }
+    }
 
-    memewm_needs_refresh = 1;
+    wptr->grid_cells = c;
 
     return;
 }
 
-void memewm_window_move(int x, int y, int window) {
-    window_t *wptr = get_window_ptr(window);
+static int frame_contains(window_t *wptr, int x, int y) {
+    return x >= wptr->x && x < wptr->x + wptr->x_size + 2 &&
+           y >= wptr->y && y < wptr->y + wptr->y_size + 1 + TITLE_BAR_THICKNESS;
+}
 
-    wptr->x += x;
-    wptr->y += y;
+/* topmost window whose frame contains the point */
+static window_t *window_at(int x, int y) {
+    if (!grid_valid || x < 0 || y < 0 || x >= memewm_screen_width || y >= memewm_screen_height) {
+        /* front to back, the first window under the pointer wins */
+        for (window_t *wptr = windows_tail; wptr; wptr = wptr->prev)
+            if (frame_contains(wptr, x, y))
+                return wptr;
+        return (window_t *)0;
+    }
 
-    memewm_needs_refresh = 1;
+    grid_cell_t *cell = &grid[(y >> GRID_CELL_SHIFT) * grid_cols + (x >> GRID_CELL_SHIFT)];
+    window_t *top = 0;
 
-    return;
+    for (int i = 0; i < cell->count; i++) {
+        window_t *wptr = cell->windows[i];
+        if ((!top || wptr->z > top->z) && frame_contains(wptr, x, y))
+            top = wptr;
+    }
+
+    return top;
 }
 
-static void quick_plot_px(int x, int y, int x_size, int y_size, uint32_t *fb, uint32_t hex) {
-    if (x >= x_size || y >= y_size || x < 0 || y < 0)
-        return;
+/* pointer to pixel (x, y) of the antibuffer */
+static uint32_t *antibuffer_at(int x, int y) {
+    return antibuffer + (size_t)x + scene_pitch * y;
+}
 
-    size_t fb_i = x + x_size * y;
+/* fills r, which must already lie on screen, row by row */
+static void fill_rect(rect_t r, uint32_t hex) {
+    uint32_t *row = antibuffer_at(r.x0, r.y0);
 
-    fb[fb_i] = hex;
+    for (int y = r.y0; y < r.y1; y++, row += scene_pitch)
+        memewm_fill32(row, r.x1 - r.x0, hex);
 
     return;
 }
 
-static uint32_t quick_get_px(int x, int y, int x_size, int y_size, uint32_t *fb) {
-    if (x >= x_size || y >= y_size || x < 0 || y < 0)
-        return 0;
-
-    size_t fb_i = x + x_size * y;
+/* expanded rows for a colour pair, null if the table could not be built */
+static const uint32_t *glyph_rows(uint32_t fg, uint32_t bg) {
+    for (int i = 0; i < GLYPH_CACHE_ENTRIES; i++) {
+        if (glyph_cache[i].rows && glyph_cache[i].fg == fg && glyph_cache[i].bg == bg)
+            return glyph_cache[i].rows;
+    }
 
-    return fb[fb_i];
-}
+    glyph_cache_entry_t *entry = &glyph_cache[glyph_cache_next];
+    glyph_cache_next = (glyph_cache_next + 1) % GLYPH_CACHE_ENTRIES;
 
-int memewm_window_resize(int x_size, int y_size, int window) {
-    window_t *wptr = get_window_ptr(window);
+    if (!entry->rows) {
+        entry->rows = memewm_malloc(256 * memewm_font_width * sizeof(uint32_t));
+        if (!entry->rows)
+            return 0;
+    }
 
-    int new_x_size;
-    int new_y_size;
+    entry->fg = fg;
+    entry->bg = bg;
 
-    if (wptr->x_size + x_size < 1) {
-        new_x_size = 1;
-    } else {
-        new_x_size = wptr->x_size + x_size;
-    }
-    if (wptr->y_size + y_size < 1) {
-        new_y_size = 1;
-    } else {
-        new_y_size = wptr->y_size + y_size;
+    uint32_t *px = entry->rows;
+    for (int line = 0; line < 256; line++) {
+        for (int j = 0; j < memewm_font_width; j++)
+            *px++ = ((line >> ((memewm_font_width - 1) - j)) & 1) ? fg : bg;
     }
 
-    uint32_t *fb = memewm_alloc(new_x_size * new_y_size * sizeof(uint32_t));
-    if (!fb)
-        return -1;
-
-    uint32_t *old_fb = wptr->framebuffer;
-    wptr->framebuffer = fb;
+    return entry->rows;
+}
 
-    int old_x_size = wptr->x_size;
-    int old_y_size = wptr->y_size;
+static void glyph_cache_flush(void) {
+    for (int i = 0; i < GLYPH_CACHE_ENTRIES; i++) {
+        memewm_free(glyph_cache[i].rows);
+        glyph_cache[i].rows = 0;
+    }
 
-    wptr->x_size = new_x_size;
-    wptr->y_size = new_y_size;
+    return;
+}
 
-    for (size_t y = 0; y < old_y_size; y++) {
-        for (size_t x = 0; x < old_x_size; x++) {
-            quick_plot_px(x, y, new_x_size, new_y_size, fb,
-                quick_get_px(x, y, old_x_size, old_y_size, old_fb));
+/* draws columns [j0, j1) of rows [i0, i1) of a glyph, dst points at the
+   first pixel drawn and rows are pitch pixels apart */
+static void draw_glyph(uint32_t *dst, size_t pitch, char c, int i0, int i1, int j0, int j1,
+                       uint32_t hex_fg, uint32_t hex_bg) {
+    const uint8_t *lines = memewm_font_bitmap + (uint8_t)c * memewm_font_height;
+    const uint32_t *rows = glyph_rows(hex_fg, hex_bg);
+
+    for (int i = i0; i < i1; i++, dst += pitch) {
+        uint8_t line = lines[i];
+
+        if (rows) {
+            memewm_copy32(dst, rows + line * memewm_font_width + j0, j1 - j0);
+        } else {
+            for (int j = j0; j < j1; j++)
+                dst[j - j0] = ((line >> ((memewm_font_width - 1) - j)) & 1) ? hex_fg : hex_bg;
         }
     }
 
-    memewm_free(old_fb);
+    return;
+}
 
-    memewm_needs_refresh = 1;
+/* screen area the cursor occupies when it sits at (x, y) */
+static rect_t cursor_rect(int x, int y) {
+    rect_t r = {x, y, x + CURSOR_SIZE, y + CURSOR_SIZE};
+    rect_t screen = {0, 0, memewm_screen_width, memewm_screen_height};
 
-    return 0;
+    return rect_intersect(r, screen);
 }
 
-int memewm_init(uint32_t *fb, int scrn_width, int scrn_height, int scrn_pitch,
-                uint8_t *fnt, int fnt_width, int fnt_height) {
-    memewm_framebuffer = fb;
-    memewm_screen_width = scrn_width;
-    memewm_screen_height = scrn_height;
-    memewm_screen_pitch = scrn_pitch;
-    memewm_font_bitmap = fnt;
-    memewm_font_width = fnt_width;
-    memewm_font_height = fnt_height;
-
-    memewm_mouse_x = memewm_screen_width / 2;
-    memewm_mouse_y = memewm_screen_height / 2;
+/* puts the saved scene pixels back where the cursor was drawn */
+static void cursor_hide(void) {
+    if (!cursor_drawn)
+        return;
 
-    memewm_fb_size = (memewm_screen_pitch / sizeof(uint32_t)) * memewm_screen_height * sizeof(uint32_t);
+    rect_t r = cursor_rect(cursor_x, cursor_y);
 
-    antibuffer = memewm_alloc(memewm_fb_size);
+    for (int y = r.y0; y < r.y1; y++) {
+        uint16_t mask = cursor.mask[y - cursor_y];
+        uint32_t *save = cursor_save + (y - cursor_y) * CURSOR_SIZE;
+        uint8_t *px = (uint8_t *)memewm_framebuffer + (size_t)memewm_screen_pitch * y;
+        for (int x = r.x0; x < r.x1; x++)
+            if ((mask >> (CURSOR_SIZE - 1 - (x - cursor_x))) & 1)
+                memewm_store_px(px + x * memewm_screen_bytes, save[x - cursor_x]);
+    }
 
-    if (!antibuffer)
-        return -1;
+    cursor_drawn = 0;
 
-    prevbuffer = memewm_alloc(memewm_fb_size);
+    return;
+}
 
-    if (!prevbuffer) {
-        memewm_free(antibuffer);
-        return -1;
+/* saves the scene under the current mouse position and draws the cursor */
+/* the antibuffer holds the scene as presented, so it is read instead of
+   the framebuffer, which may be slow to read back */
+static void cursor_show(void) {
+    cursor_x = memewm_mouse_x;
+    cursor_y = memewm_mouse_y;
+
+    rect_t r = cursor_rect(cursor_x, cursor_y);
+
+    for (int y = r.y0; y < r.y1; y++) {
+        uint16_t mask = cursor.mask[y - cursor_y];
+        uint16_t colour = cursor.colour[y - cursor_y];
+        uint32_t *save = cursor_save + (y - cursor_y) * CURSOR_SIZE;
+        uint8_t *px = (uint8_t *)memewm_framebuffer + (size_t)memewm_screen_pitch * y;
+        uint32_t *scene = antibuffer + scene_pitch * y;
+        for (int x = r.x0; x < r.x1; x++) {
+            int bit = CURSOR_SIZE - 1 - (x - cursor_x);
+            if (!((mask >> bit) & 1))
+                continue;
+            save[x - cursor_x] = scene[x];
+            memewm_store_px(px + x * memewm_screen_bytes, cursor.palette[(colour >> bit) & 1]);
+        }
     }
 
-    memewm_needs_refresh = 1;
-    memewm_refresh();
+    cursor_drawn = 1;
 
-    return 0;
+    return;
 }
 
-void memewm_refresh(void) {
-    if (!memewm_needs_refresh)
+/* moves the cursor without touching anything but its old and new area */
+static void cursor_move(void) {
+    if (cursor_drawn && cursor_x == memewm_mouse_x && cursor_y == memewm_mouse_y)
         return;
 
-    memewm_needs_refresh = 0;
+    /* a flipped screen only changes a whole frame at a time, the next
+       refresh takes the cursor along */
+    if (memewm_backend.buffer_count == 2) {
+        damage_rect(cursor_rect(memewm_mouse_x, memewm_mouse_y));
+        return;
+    }
 
-    uint32_t *tmpbufptr = prevbuffer;
-    prevbuffer = antibuffer;
-    antibuffer = tmpbufptr;
+    cursor_hide();
+    cursor_show();
 
-    /* draw background */
-    for (size_t i = 0; i < memewm_fb_size / sizeof(uint32_t); i++)
-        antibuffer[i] = BACKGROUND_COLOUR;
+    return;
+}
 
-    /* draw every window */
-    window_t *wptr = windows;
-    for (;;) {
-        if (!wptr)
-            break;
+/* puts a window on top of the stack */
+static void link_window(window_t *wptr) {
+    wptr->prev = windows_tail;
+    wptr->next = 0;
+    wptr->z = ++z_counter;
 
-        /* draw the title bar */
-        for (size_t x = 0; x < TITLE_BAR_THICKNESS; x++)
-            for (size_t i = 0; i < wptr->x_size + 2; i++)
-                plot_px(wptr->x + i, wptr->y + x, TITLE_BAR_BACKG);
-
-        /* draw the title */
-        for (size_t i = 0; wptr->title[i]; i++) {
-            if ((wptr->x + memewm_font_width + (i + 1) * memewm_font_width) >= wptr->x + wptr->x_size)
-                break;
-            plot_char(wptr->title[i], wptr->x + memewm_font_width + i * memewm_font_width, wptr->y + 1,
-                TITLE_BAR_FOREG, TITLE_BAR_BACKG);
-        }
+    if (windows_tail)
+        windows_tail->next = wptr;
+    else
+        windows = wptr;
+    windows_tail = wptr;
 
-        /* draw the window border */
-        for (size_t i = 0; i < wptr->x_size + 2; i++)
-            plot_px(wptr->x + i, wptr->y, WINDOW_BORDERS);
-        for (size_t i = 0; i < wptr->x_size + 2; i++)
-            plot_px(wptr->x + i, wptr->y + TITLE_BAR_THICKNESS + wptr->y_size, WINDOW_BORDERS);
-        for (size_t i = 0; i < wptr->y_size + TITLE_BAR_THICKNESS + 1; i++)
-            plot_px(wptr->x, wptr->y + i, WINDOW_BORDERS);
-        for (size_t i = 0; i < wptr->y_size + TITLE_BAR_THICKNESS + 1; i++)
-            plot_px(wptr->x + wptr->x_size + 1, wptr->y + i, WINDOW_BORDERS);
-
-        /* paint the framebuffer */
-        size_t in_x = 1;
-        size_t in_y = TITLE_BAR_THICKNESS;
-        for (size_t i = 0; i < wptr->x_size * wptr->y_size; i++) {
-            plot_px(in_x++ + wptr->x, in_y + wptr->y, wptr->framebuffer[i]);
-            if (in_x - 1 == wptr->x_size) {
-                in_y++;
-                in_x = 1;
-            }
-        }
+    return;
+}
 
-        wptr = wptr->next;
-    }
+static void unlink_window(window_t *wptr) {
+    if (wptr->prev)
+        wptr->prev->next = wptr->next;
+    else
+        windows = wptr->next;
 
-    /* copy over the buffer */
-    for (size_t i = 0; i < memewm_fb_size / sizeof(uint32_t); i++) {
-        if (antibuffer[i] != prevbuffer[i])
-            memewm_framebuffer[i] = antibuffer[i];
-    }
+    if (wptr->next)
+        wptr->next->prev = wptr->prev;
+    else
+        windows_tail = wptr->prev;
 
-    memewm_update_cursor();
+    wptr->next = wptr->prev = 0;
 
     return;
 }
 
-void memewm_set_cursor_pos(int x, int y) {
-    if (memewm_mouse_x + x < 0) {
-        memewm_mouse_x = 0;
-    } else if (memewm_mouse_x + x >= memewm_screen_width) {
-        memewm_mouse_x = memewm_screen_width - 1;
-    } else {
-        memewm_mouse_x += x;
-    }
+static window_t *get_window_ptr(int id) {
+    if (id < 0)
+        return (window_t *)0;
 
-    if (memewm_mouse_y + y < 0) {
-        memewm_mouse_y = 0;
-    } else if (memewm_mouse_y + y >= memewm_screen_height) {
-        memewm_mouse_y = memewm_screen_height - 1;
-    } else {
-        memewm_mouse_y += y;
-    }
+    int slot = id & WINDOW_SLOT_MASK;
 
-    memewm_update_cursor();
+    if (slot >= window_slots_size)
+        return (window_t *)0;
 
-    return;
+    if (window_slots[slot].generation != id >> WINDOW_SLOT_BITS)
+        return (window_t *)0;
+
+    return window_slots[slot].window;
 }
 
-void memewm_set_cursor_pos_abs(int x, int y) {
-    if (x < 0) {
-        memewm_mouse_x = 0;
-    } else if (x >= memewm_screen_width) {
-        memewm_mouse_x = memewm_screen_width - 1;
-    } else {
-        memewm_mouse_x = x;
-    }
+/* takes a slot off the free list, doubling the table when it runs dry */
+static int alloc_window_slot(void) {
+    if (window_slots_free == -1) {
+        int new_size = window_slots_size ? window_slots_size * 2 : 16;
 
-    if (y < 0) {
-        memewm_mouse_y = 0;
-    } else if (y >= memewm_screen_height) {
-        memewm_mouse_y = memewm_screen_height - 1;
-    } else {
-        memewm_mouse_y = y;
+        if (new_size > WINDOW_SLOT_MASK + 1)
+            return -1;
+
+        window_slot_t *new_slots = memewm_realloc(window_slots, new_size * sizeof(window_slot_t));
+        if (!new_slots)
+            return -1;
+
+        /* chain the new slots so the lowest index comes off first */
+        for (int i = new_size - 1; i >= window_slots_size; i--) {
+            new_slots[i].window = 0;
+            new_slots[i].generation = 0;
+            new_slots[i].next_free = window_slots_free;
+            window_slots_free = i;
+        }
+
+        window_slots = new_slots;
+        window_slots_size = new_size;
     }
 
-    memewm_update_cursor();
+    int slot = window_slots_free;
+    window_slots_free = window_slots[slot].next_free;
+
+    return slot;
+}
+
+static void free_window_slot(int slot) {
+    window_slots[slot].window = 0;
+    window_slots[slot].next_free = window_slots_free;
+    window_slots_free = slot;
 
     return;
 }
 
-void memewm_get_cursor_pos(int *x, int *y) {
-    *x = memewm_mouse_x;
-    *y = memewm_mouse_y;
+/* zeroes [x0, x1) x [y0, y1) of a window's surface */
+static void clear_window_area(window_t *wptr, int x0, int y0, int x1, int y1) {
+    if (x0 >= x1)
+        return;
+
+    for (int y = y0; y < y1; y++)
+        memewm_fill32(wptr->framebuffer + (size_t)wptr->stride * y + x0, x1 - x0, 0);
 
     return;
 }
 
-window_click_data_t memewm_window_click(int x, int y) {
-    window_click_data_t ret = {0};
-    window_t *wptr = windows;
+/* backing stores grow by half again, so a window dragged a pixel at a
+   time only reallocates a logarithmic number of times */
+static int grow_dimension(int current, int needed) {
+    if (needed <= current)
+        return current;
 
-    if (!wptr)
-        goto fail;
-
-    /* get number of nodes */
-    size_t nodes;
-    for (nodes = 0; wptr->next; nodes++, wptr = wptr->next);
-
-    for (;; nodes--) {
-        wptr = windows;
-        for (size_t i = 0; i < nodes; i++)
-            wptr = wptr->next;
-
-        if (x >= wptr->x && x < wptr->x + wptr->x_size + 2 &&
-            y >= wptr->y && y < wptr->y + wptr->y_size + 1 + TITLE_BAR_THICKNESS) {
-            int in_canvas = 1;
-            ret.id = wptr->id;
-            ret.rel_x = ret.rel_y = -1;
-            if (y - wptr->y < TITLE_BAR_THICKNESS
-                && y - wptr->y > 0 && y - wptr->y < wptr->y_size + TITLE_BAR_THICKNESS
-                && x - wptr->x > 0 && x - wptr->x < wptr->x_size) {
-                in_canvas = 0;
-                ret.titlebar = 1;
-            } else {
-                ret.titlebar = 0;
-            }
-            if (y - wptr->y == 0) {
-                in_canvas = 0;
-                ret.top_border = 1;
-                ret.bottom_border = 0;
-            } else if (y - wptr->y == wptr->y_size + TITLE_BAR_THICKNESS) {
-                in_canvas = 0;
-                ret.bottom_border = 1;
-                ret.top_border = 0;
-            }
-            if (x - wptr->x == 0) {
-                in_canvas = 0;
-                ret.left_border = 1;
-                ret.right_border = 0;
-            } else if (x - wptr->x == wptr->x_size + 1) {
-                in_canvas = 0;
-                ret.right_border = 1;
-                ret.left_border = 0;
-            }
-            if (in_canvas) {
-                ret.rel_x = x - (wptr->x + 1);
-                ret.rel_y = y - (wptr->y + TITLE_BAR_THICKNESS);
-            }
-            return ret;
-        }
+    int grown = current + current / 2;
 
-        if (!nodes)
+    return grown > needed ? grown : needed;
+}
+/* number of title glyphs that fit in the title bar */
+/* the sum is done in size_t, so a window hanging more than two glyphs
+   off the left edge of the screen shows no title at all */
+static int title_glyphs(window_t *wptr) {
+    size_t i;
+
+    for (i = 0; wptr->title[i]; i++) {
+        if ((wptr->x + memewm_font_width + (i + 1) * memewm_font_width)
+            >= (size_t)(wptr->x + wptr->x_size))
             break;
     }
 
-fail:
-    ret.id = -1;
-    return ret;
+    return i;
 }
 
-void memewm_window_plot_px(int x, int y, uint32_t hex, int window) {
-    window_t *wptr = get_window_ptr(window);
+/* makes room for the decorations of a frame width wide */
+static int reserve_decorations(window_t *wptr, int width) {
+    if ((size_t)width * TITLE_BAR_THICKNESS <= wptr->decorations_capacity)
+        return 0;
 
-    if (!wptr)
+    size_t capacity;
+    uint32_t *decorations = memewm_surface_alloc(
+        (size_t)grow_dimension(wptr->decorations_capacity / TITLE_BAR_THICKNESS, width) * TITLE_BAR_THICKNESS,
+        &capacity);
+    if (!decorations)
+        return -1;
+
+    memewm_surface_free(wptr->decorations, wptr->decorations_capacity);
+    wptr->decorations = decorations;
+    wptr->decorations_capacity = capacity;
+    /* the new store holds nothing yet, have it rendered again */
+    wptr->decorations_width = 0;
+
+    return 0;
+}
+
+/* renders the title bar rows of the frame, the only part of the
+   decorations that is not a flat colour, room must have been reserved */
+static void render_decorations(window_t *wptr) {
+    int width = wptr->x_size + 2;
+    int glyphs = title_glyphs(wptr);
+
+    if (width == wptr->decorations_width && glyphs == wptr->decorations_glyphs)
+        return;
+
+    wptr->decorations_width = width;
+    wptr->decorations_glyphs = glyphs;
+
+    memewm_fill32(wptr->decorations, (size_t)width * TITLE_BAR_THICKNESS, TITLE_BAR_BACKG);
+
+    /* glyph rows past the title bar are cut off */
+    int glyph_rows = memewm_font_height < TITLE_BAR_THICKNESS - 1 ? memewm_font_height : TITLE_BAR_THICKNESS - 1;
+    for (int i = 0; i < glyphs; i++) {
+        int char_x = memewm_font_width + i * memewm_font_width;
+        int char_x1 = char_x + memewm_font_width < width ? char_x + memewm_font_width : width;
+        if (char_x >= width)
+            break;
+        draw_glyph(wptr->decorations + width + char_x, width, wptr->title[i],
+                   0, glyph_rows, 0, char_x1 - char_x, TITLE_BAR_FOREG, TITLE_BAR_BACKG);
+    }
+
+    memewm_fill32(wptr->decorations, width, WINDOW_BORDERS);
+    for (int y = 0; y < TITLE_BAR_THICKNESS; y++) {
+        wptr->decorations[(size_t)width * y] = WINDOW_BORDERS;
+        wptr->decorations[(size_t)width * y + width - 1] = WINDOW_BORDERS;
+    }
+
+    return;
+}
+
+/* gives back everything a window holds, parts never allocated are null */
+static void free_window(window_t *wptr) {
+    if (!wptr->client_buffer)
+        memewm_surface_free(wptr->framebuffer, wptr->capacity);
+    else if (wptr->owns_buffer)
+        memewm_free(wptr->framebuffer);
+    memewm_surface_free(wptr->decorations, wptr->decorations_capacity);
+    memewm_surface_free(wptr->thumbnail, wptr->thumbnail_capacity);
+    if (wptr->title)
+        memewm_small_free(wptr->title, memewm_strlen(wptr->title) + 1);
+    memewm_small_free(wptr, sizeof(window_t));
+
+    return;
+}
+
+/* has the whole thumbnail redrawn next time, for when the surface changed size */
+static void thumbnail_invalidate(window_t *wptr) {
+    wptr->thumbnail_stale = (rect_t){0, 0, wptr->x_size, wptr->y_size};
+
+    return;
+}
+
+/* brings the thumbnail up to date at 1 << shift times smaller than the
+   surface, only the blocks drawn to since the last update are filtered
+   again unless the thumbnail changed size */
+/* *changed is set to the part of the thumbnail that was redrawn */
+/* returns -1 if there was no room for it */
+static int thumbnail_update(window_t *wptr, int shift, rect_t *changed) {
+    int block = 1 << shift;
+    int width = (wptr->x_size + block - 1) >> shift;
+    int height = (wptr->y_size + block - 1) >> shift;
+    rect_t stale = wptr->thumbnail_stale;
+
+    *changed = (rect_t){0, 0, 0, 0};
+
+    if (!wptr->thumbnail || shift != wptr->thumbnail_shift
+        || width != wptr->thumbnail_width || height != wptr->thumbnail_height) {
+        size_t pixels = (size_t)width * height;
+
+        if (pixels > wptr->thumbnail_capacity) {
+            size_t capacity;
+            uint32_t *thumbnail = memewm_surface_alloc(pixels, &capacity);
+            if (!thumbnail)
+                return -1;
+
+            memewm_surface_free(wptr->thumbnail, wptr->thumbnail_capacity);
+            wptr->thumbnail = thumbnail;
+            wptr->thumbnail_capacity = capacity;
+        }
+
+        wptr->thumbnail_shift = shift;
+        wptr->thumbnail_width = width;
+        wptr->thumbnail_height = height;
+        stale = (rect_t){0, 0, wptr->x_size, wptr->y_size};
+    }
+
+    wptr->thumbnail_stale = (rect_t){0, 0, 0, 0};
+
+    /* a shrink may have cut some of the stale area off */
+    stale = rect_intersect(stale, (rect_t){0, 0, wptr->x_size, wptr->y_size});
+    if (rect_empty(stale))
+        return 0;
+
+    /* out to whole blocks */
+    rect_t t = {stale.x0 >> shift, stale.y0 >> shift,
+                (stale.x1 + block - 1) >> shift, (stale.y1 + block - 1) >> shift};
+    int x = t.x0 << shift;
+
+    for (int ty = t.y0; ty < t.y1; ty++) {
+        int y = ty << shift;
+        int rows = wptr->y_size - y < block ? wptr->y_size - y : block;
+
+        memewm_downscale_row(wptr->thumbnail + (size_t)width * ty + t.x0,
+                             wptr->framebuffer + (size_t)wptr->stride * y + x, wptr->stride,
+                             t.x1 - t.x0, shift, wptr->x_size - x, rows);
+    }
+
+    *changed = t;
+
+    return 0;
+}
+
+/* files a new window around a surface that is already set up */
+static int create_window(window_t *wptr, char *title, size_t x, size_t y,
+                         size_t x_size, size_t y_size) {
+    int slot = alloc_window_slot();
+    if (slot == -1)
+        return -1;
+
+    /* copied right away, free_window goes by its length */
+    wptr->title = memewm_small_alloc(memewm_strlen(title) + 1);
+    if (wptr->title)
+        memewm_strcpy(wptr->title, title);
+
+    if (!wptr->title || reserve_decorations(wptr, x_size + 2)) {
+        free_window_slot(slot);
+        return -1;
+    }
+
+    int id = (window_slots[slot].generation << WINDOW_SLOT_BITS) | slot;
+
+    wptr->id = id;
+    wptr->alpha = 255;
+    wptr->x = x;
+    wptr->y = y;
+    wptr->x_size = x_size;
+    wptr->y_size = y_size;
+
+    render_decorations(wptr);
+
+    window_slots[slot].window = wptr;
+
+    link_window(wptr);
+    grid_update(wptr);
+    overview_dirty = 1;
+
+    memewm_current_window = id;
+
+    damage_window(wptr);
+
+    return id;
+}
+
+/* creates a new window with a title, size */
+/* returns window id */
+int memewm_window_create(char *title, size_t x, size_t y, size_t x_size, size_t y_size) {
+    window_t *wptr = memewm_small_alloc(sizeof(window_t));
+    if (!wptr)
+        return -1;
+
+    wptr->framebuffer = memewm_surface_alloc(x_size * y_size, &wptr->capacity);
+    wptr->stride = x_size;
+    wptr->owns_buffer = true;
+
+    if (!wptr->framebuffer) {
+        free_window(wptr);
+        return -1;
+    }
+
+    /* recycled stores hold whatever the last owner left */
+    memewm_fill32(wptr->framebuffer, x_size * y_size, 0);
+
+    int id = create_window(wptr, title, x, y, x_size, y_size);
+    if (id == -1)
+        free_window(wptr);
+
+    return id;
+}
+
+/* creates a window showing the client's own pixels, rows are pitch bytes apart */
+/* the buffer is read in place on every refresh, changes show up once
+   reported with memewm_window_damage */
+/* with owned set the window takes the buffer over and hands it to
+   memewm_free on destroy, otherwise it has to outlive the window */
+/* returns window id */
+int memewm_window_create_with_buffer(char *title, size_t x, size_t y, size_t x_size, size_t y_size,
+                                     uint32_t *buffer, size_t pitch, int owned) {
+    if (!buffer || pitch % sizeof(uint32_t) || pitch / sizeof(uint32_t) < x_size)
+        return -1;
+
+    window_t *wptr = memewm_small_alloc(sizeof(window_t));
+    if (!wptr)
+        return -1;
+
+    wptr->framebuffer = buffer;
+    wptr->stride = pitch / sizeof(uint32_t);
+    wptr->capacity = (size_t)wptr->stride * y_size;
+    wptr->client_buffer = true;
+
+    int id = create_window(wptr, title, x, y, x_size, y_size);
+    /* a window that never came to be does not take the buffer */
+    if (id == -1)
+        free_window(wptr);
+    else
+        wptr->owns_buffer = owned;
+
+    return id;
+}
+
+void memewm_window_destroy(int window) {
+    window_t *wptr = get_window_ptr(window);
+
+    if (!wptr)
+        return;
+
+    unlink_window(wptr);
+    if (grid_valid)
+        grid_remove(wptr);
+
+    damage_window(wptr);
+    overview_dirty = 1;
+
+    int slot = window & WINDOW_SLOT_MASK;
+    /* handles to the old window stop resolving from here on */
+    window_slots[slot].generation = (window_slots[slot].generation + 1) & WINDOW_GENERATION_MASK;
+    free_window_slot(slot);
+
+    if (memewm_current_window == window)
+        memewm_current_window = -1;
+
+    free_window(wptr);
+
+    return;
+}
+
+void memewm_window_focus(int window) {
+    /* moves the requested window to the foreground */
+    window_t *wptr = get_window_ptr(window);
+
+    if (!wptr)
+        return;
+
+    if (wptr == windows_tail)
+        return;
+
+    unlink_window(wptr);
+    link_window(wptr);
+
+    memewm_current_window = window;
+
+    /* only the area the window used to share with the ones above changes */
+    damage_window(wptr);
+
+    return;
+}
+
+void memewm_window_move(int x, int y, int window) {
+    window_t *wptr = get_window_ptr(window);
+
+    if (!wptr)
+        return;
+
+    damage_window(wptr);
+
+    wptr->x += x;
+    wptr->y += y;
+
+    /* only ever changes the title, when crossing the left edge */
+    render_decorations(wptr);
+    grid_update(wptr);
+    damage_window(wptr);
+
+    return;
+}
+
+int memewm_window_resize(int x_size, int y_size, int window) {
+    window_t *wptr = get_window_ptr(window);
+
+    int new_x_size;
+    int new_y_size;
+
+    if (!wptr)
+        return -1;
+
+    if (wptr->x_size + x_size < 1) {
+        new_x_size = 1;
+    } else {
+        new_x_size = wptr->x_size + x_size;
+    }
+    if (wptr->y_size + y_size < 1) {
+        new_y_size = 1;
+    } else {
+        new_y_size = wptr->y_size + y_size;
+    }
+
+    int old_x_size = wptr->x_size;
+    int old_y_size = wptr->y_size;
+    int kept_x_size = old_x_size < new_x_size ? old_x_size : new_x_size;
+    int kept_y_size = old_y_size < new_y_size ? old_y_size : new_y_size;
+
+    /* a client buffer is as big as it is */
+    if (wptr->client_buffer
+        && (new_x_size > wptr->stride || (size_t)wptr->stride * new_y_size > wptr->capacity))
+        return -1;
+
+    uint32_t *fb = NULL;
+    int new_stride = wptr->stride;
+    size_t new_capacity = wptr->capacity;
+
+    if (new_x_size > wptr->stride || (size_t)wptr->stride * new_y_size > wptr->capacity) {
+        /* out of room, move the surface into a bigger store */
+        new_stride = grow_dimension(wptr->stride, new_x_size);
+        /* windows created zero wide have no rows to speak of */
+        int rows = wptr->stride ? wptr->capacity / wptr->stride : 0;
+        int new_rows = grow_dimension(rows, new_y_size);
+
+        fb = memewm_surface_alloc((size_t)new_stride * new_rows, &new_capacity);
+        if (!fb)
+            return -1;
+    }
+
+    /* both stores are in hand before the window is touched, a failed
+       resize leaves it as it was */
+    if (reserve_decorations(wptr, new_x_size + 2)) {
+        memewm_surface_free(fb, new_capacity);
+        return -1;
+    }
+
+    if (fb) {
+        for (int y = 0; y < kept_y_size; y++)
+            memewm_copy32(fb + (size_t)new_stride * y,
+                          wptr->framebuffer + (size_t)wptr->stride * y, kept_x_size);
+
+        memewm_surface_free(wptr->framebuffer, wptr->capacity);
+        wptr->framebuffer = fb;
+        wptr->stride = new_stride;
+        wptr->capacity = new_capacity;
+    }
+
+    damage_window(wptr);
+
+    /* shrinking keeps the store, whatever was cut off is cleared when
+       it comes back into view so the window reads as freshly resized */
+    /* client buffers are left alone, what is in them is the client's */
+    if (!wptr->client_buffer) {
+        clear_window_area(wptr, kept_x_size, 0, new_x_size, kept_y_size);
+        clear_window_area(wptr, 0, kept_y_size, new_x_size, new_y_size);
+    }
+
+    wptr->x_size = new_x_size;
+    wptr->y_size = new_y_size;
+
+    render_decorations(wptr);
+    grid_update(wptr);
+    damage_window(wptr);
+
+    thumbnail_invalidate(wptr);
+    overview_dirty = 1;
+
+    return 0;
+}
+
+int memewm_init(uint32_t *fb, int scrn_width, int scrn_height, int scrn_pitch,
+                uint8_t *fnt, int fnt_width, int fnt_height) {
+    memewm_backend_t backend = {1, {fb, 0}, 0, 0, MEMEWM_FORMAT_XRGB8888};
+
+    return memewm_init_backend(&backend, scrn_width, scrn_height, scrn_pitch,
+                               fnt, fnt_width, fnt_height);
+}
+
+int memewm_init_backend(const memewm_backend_t *backend, int scrn_width, int scrn_height,
+                        int scrn_pitch, uint8_t *fnt, int fnt_width, int fnt_height) {
+    int bytes = memewm_format_bytes(backend->format);
+
+    /* flipping composes into the screen, which has to be in memewm's format */
+    if (!bytes || (backend->buffer_count == 2 && backend->format != MEMEWM_FORMAT_XRGB8888))
+        return -1;
+
+    memewm_backend = *backend;
+    memewm_framebuffer = backend->buffers[0];
+    memewm_screen_width = scrn_width;
+    memewm_screen_height = scrn_height;
+    memewm_screen_pitch = scrn_pitch;
+    memewm_screen_bytes = bytes;
+    memewm_font_bitmap = fnt;
+    memewm_font_width = fnt_width;
+    memewm_font_height = fnt_height;
+
+    glyph_cache_flush();
+
+    memewm_mouse_x = memewm_screen_width / 2;
+    memewm_mouse_y = memewm_screen_height / 2;
+
+    memewm_pixel_set_format(backend->format);
+
+    if (backend->format == MEMEWM_FORMAT_XRGB8888)
+        scene_pitch = memewm_screen_pitch / sizeof(uint32_t);
+    else
+        scene_pitch = memewm_screen_width;
+
+    memewm_fb_size = scene_pitch * memewm_screen_height * sizeof(uint32_t);
+
+    if (grid_init())
+        return -1;
+
+    /* flipping composes into the buffers themselves */
+    if (memewm_backend.buffer_count == 2) {
+        flip_front = 0;
+        flip_damage_count = 0;
+        flip_cursor[0] = flip_cursor[1] = (rect_t){0, 0, 0, 0};
+        damage_rect((rect_t){0, 0, memewm_screen_width, memewm_screen_height});
+        memewm_refresh();
+        return 0;
+    }
+
+    antibuffer = memewm_calloc(1, memewm_fb_size);
+
+    if (!antibuffer)
+        return -1;
+
+    tile_cols = (memewm_screen_width + (1 << TILE_SHIFT_X) - 1) >> TILE_SHIFT_X;
+    tile_rows = (memewm_screen_height + (1 << TILE_SHIFT_Y) - 1) >> TILE_SHIFT_Y;
+    tile_words = (tile_cols + 63) / 64;
+    dirty_tiles = memewm_calloc((size_t)tile_words * tile_rows, sizeof(uint64_t));
+
+    if (!dirty_tiles) {
+        memewm_free(antibuffer);
+        return -1;
+    }
+
+    damage_rect((rect_t){0, 0, memewm_screen_width, memewm_screen_height});
+    memewm_refresh();
+
+    return 0;
+}
+
+static bool window_translucent(window_t *wptr) {
+    return wptr->alpha != 255 || wptr->surface_alpha;
+}
+
+/* puts a row of a window into the antibuffer, blended over what is there
+   if the window is translucent */
+static inline void paint_row(uint32_t *dst, const uint32_t *src, size_t count, int alpha,
+                             bool surface_alpha) {
+    if (surface_alpha)
+        memewm_blend32_argb(dst, src, count, alpha);
+    else if (alpha == 255)
+        memewm_copy32(dst, src, count);
+    else
+        memewm_blend32(dst, src, count, alpha);
+
+    return;
+}
+
+static inline void paint_border(uint32_t *px, int alpha) {
+    *px = alpha == 255 ? WINDOW_BORDERS : memewm_blend_px(WINDOW_BORDERS, *px, alpha);
+
+    return;
+}
+
+/* the window gets clipped against the damaged area once, then every
+   decoration and content row goes into the antibuffer as a whole span */
+static void paint_window(window_t *wptr, rect_t clip) {
+    rect_t r = rect_intersect(window_frame(wptr), clip);
+
+    if (rect_empty(r))
+        return;
+
+    size_t pitch = scene_pitch;
+    int title_y1 = wptr->y + TITLE_BAR_THICKNESS;
+    int bottom_y = wptr->y + TITLE_BAR_THICKNESS + wptr->y_size;
+    int right_x = wptr->x + wptr->x_size + 1;
+
+    /* copy the pre-rendered title bar */
+    int y1 = r.y1 < title_y1 ? r.y1 : title_y1;
+    if (r.y0 < y1) {
+        uint32_t *dst = antibuffer_at(r.x0, r.y0);
+        const uint32_t *src = wptr->decorations + (size_t)wptr->decorations_width * (r.y0 - wptr->y)
+                              + (r.x0 - wptr->x);
+        for (int y = r.y0; y < y1; y++, dst += pitch, src += wptr->decorations_width)
+            paint_row(dst, src, r.x1 - r.x0, wptr->alpha, false);
+    }
+
+    /* draw the side and bottom borders */
+    int y0 = r.y0 > title_y1 ? r.y0 : title_y1;
+    if (bottom_y < r.y1) {
+        uint32_t *px = antibuffer_at(r.x0, bottom_y);
+        if (wptr->alpha == 255)
+            memewm_fill32(px, r.x1 - r.x0, WINDOW_BORDERS);
+        else
+            for (int x = r.x0; x < r.x1; x++)
+                paint_border(px++, wptr->alpha);
+    }
+    y1 = r.y1 < bottom_y ? r.y1 : bottom_y;
+    if (wptr->x >= r.x0) {
+        uint32_t *px = antibuffer_at(wptr->x, y0);
+        for (int y = y0; y < y1; y++, px += pitch)
+            paint_border(px, wptr->alpha);
+    }
+    if (right_x < r.x1) {
+        uint32_t *px = antibuffer_at(right_x, y0);
+        for (int y = y0; y < y1; y++, px += pitch)
+            paint_border(px, wptr->alpha);
+    }
+
+    /* paint the framebuffer */
+    int x0 = r.x0 > wptr->x + 1 ? r.x0 : wptr->x + 1;
+    int x1 = r.x1 < right_x ? r.x1 : right_x;
+    if (x0 < x1 && y0 < y1) {
+        uint32_t *dst = antibuffer_at(x0, y0);
+        uint32_t *src = wptr->framebuffer + (size_t)wptr->stride * (y0 - title_y1) + (x0 - (wptr->x + 1));
+        for (int y = y0; y < y1; y++, dst += pitch, src += wptr->stride)
+            paint_row(dst, src, x1 - x0, wptr->alpha, wptr->surface_alpha);
+    }
+
+    return;
+}
+
+/* paints the part of a window's overview rect that falls into clip */
+static void paint_thumbnail(window_t *wptr, rect_t clip) {
+    rect_t o = wptr->overview_rect;
+    rect_t inner = {o.x0 + 1, o.y0 + 1, o.x1 - 1, o.y1 - 1};
+    rect_t content = rect_intersect(inner, (rect_t){inner.x0, inner.y0,
+                                                    inner.x0 + wptr->thumbnail_width,
+                                                    inner.y0 + wptr->thumbnail_height});
+    size_t pitch = scene_pitch;
+
+    content = rect_intersect(content, clip);
+    if (wptr->thumbnail && !rect_empty(content)) {
+        uint32_t *dst = antibuffer_at(content.x0, content.y0);
+        const uint32_t *src = wptr->thumbnail + (size_t)wptr->thumbnail_width * (content.y0 - inner.y0)
+                              + (content.x0 - inner.x0);
+        for (int y = content.y0; y < content.y1; y++, dst += pitch, src += wptr->thumbnail_width)
+            paint_row(dst, src, content.x1 - content.x0, wptr->alpha, wptr->surface_alpha);
+    }
+
+    /* the border round it */
+    for (int y = clip.y0; y < clip.y1; y++) {
+        uint32_t *row = antibuffer_at(0, y);
+
+        if (y == o.y0 || y == o.y1 - 1) {
+            for (int x = clip.x0; x < clip.x1; x++)
+                paint_border(row + x, wptr->alpha);
+            continue;
+        }
+        if (o.x0 >= clip.x0)
+            paint_border(row + o.x0, wptr->alpha);
+        if (o.x1 - 1 < clip.x1)
+            paint_border(row + o.x1 - 1, wptr->alpha);
+    }
+
+    return;
+}
+
+static void paint_background(rect_t r) {
+    fill_rect(r, BACKGROUND_COLOUR);
+
+    return;
+}
+
+/* appends the parts of u outside of cut (which lies within u) to the list */
+static int subtract_rect(rect_t *list, int count, rect_t u, rect_t cut) {
+    rect_t bands[4] = {
+        {u.x0, u.y0, u.x1, cut.y0},
+        {u.x0, cut.y1, u.x1, u.y1},
+        {u.x0, cut.y0, cut.x0, cut.y1},
+        {cut.x1, cut.y0, u.x1, cut.y1},
+    };
+
+    for (int i = 0; i < 4; i++) {
+        if (rect_empty(bands[i]))
+            continue;
+        if (count == MAX_VISIBLE_RECTS)
+            return -1;
+        list[count++] = bands[i];
+    }
+
+    return count;
+}
+
+/* walks the windows front to back and paints only the part of each one
+   nothing in front of it covers, so every pixel of r is written once */
+/* translucent windows cover nothing, what they show of themselves is
+   blended in back to front once everything behind them is painted */
+/* returns -1 if the region got too fragmented to track */
+static int compose_rect_visible(compose_ctx_t *ctx, rect_t r) {
+    int cur = 0;
+    int count = 1;
+
+    ctx->uncovered[cur][0] = r;
+    ctx->blend_count = 0;
+
+    for (window_t *wptr = windows_tail; wptr && count; wptr = wptr->prev) {
+        rect_t frame = window_frame(wptr);
+        int next_count = 0;
+
+        if (rect_empty(rect_intersect(frame, r)))
+            continue;
+
+        if (window_translucent(wptr)) {
+            for (int j = 0; j < count; j++) {
+                rect_t visible = rect_intersect(ctx->uncovered[cur][j], frame);
+                if (rect_empty(visible))
+                    continue;
+                if (ctx->blend_count == MAX_BLEND_RECTS)
+                    return -1;
+                ctx->blends[ctx->blend_count++] = (blend_rect_t){wptr, visible};
+            }
+            continue;
+        }
+
+        for (int j = 0; j < count; j++) {
+            rect_t u = ctx->uncovered[cur][j];
+            rect_t visible = rect_intersect(u, frame);
+
+            if (rect_empty(visible)) {
+                if (next_count == MAX_VISIBLE_RECTS)
+                    return -1;
+                ctx->uncovered[!cur][next_count++] = u;
+                continue;
+            }
+
+            paint_window(wptr, visible);
+            ctx->stats.painted_px += rect_area(visible);
+
+            next_count = subtract_rect(ctx->uncovered[!cur], next_count, u, visible);
+            if (next_count == -1)
+                return -1;
+        }
+
+        /* once fully covered, nothing further back can show */
+        cur = !cur;
+        count = next_count;
+    }
+
+    for (int j = 0; j < count; j++) {
+        paint_background(ctx->uncovered[cur][j]);
+        ctx->stats.painted_px += rect_area(ctx->uncovered[cur][j]);
+    }
+
+    for (int i = ctx->blend_count - 1; i >= 0; i--) {
+        paint_window(ctx->blends[i].window, ctx->blends[i].r);
+        ctx->stats.painted_px += rect_area(ctx->blends[i].r);
+    }
+
+    return 0;
+}
+
+/* recomposites one damaged area of the screen into the antibuffer */
+/* the overview is the background with the thumbnails on top, which
+   never overlap */
+static void compose_overview_rect(compose_ctx_t *ctx, rect_t r) {
+    size_t painted = rect_area(r);
+
+    paint_background(r);
+
+    for (window_t *wptr = windows; wptr; wptr = wptr->next) {
+        rect_t o = rect_intersect(wptr->overview_rect, r);
+        if (rect_empty(o))
+            continue;
+
+        paint_thumbnail(wptr, o);
+        painted += rect_area(o);
+    }
+
+    ctx->stats.damaged_px += rect_area(r);
+    ctx->stats.covered_px += painted;
+    ctx->stats.painted_px += painted;
+
+    return;
+}
+
+static void compose_rect(compose_ctx_t *ctx, rect_t r) {
+    if (overview) {
+        compose_overview_rect(ctx, r);
+        return;
+    }
+
+    size_t covered = rect_area(r);
+
+    for (window_t *wptr = windows; wptr; wptr = wptr->next)
+        covered += rect_area(rect_intersect(window_frame(wptr), r));
+
+    ctx->stats.damaged_px += rect_area(r);
+    ctx->stats.covered_px += covered;
+
+    if (compose_rect_visible(ctx, r) == 0)
+        return;
+
+    /* fall back to painting back to front over whatever got drawn */
+    paint_background(r);
+    for (window_t *wptr = windows; wptr; wptr = wptr->next)
+        paint_window(wptr, r);
+
+    ctx->stats.painted_px += covered;
+
+    return;
+}
+
+/* sets the bit of every tile r reaches into */
+static void tiles_mark(rect_t r) {
+    int tx0 = r.x0 >> TILE_SHIFT_X;
+    int tx1 = (r.x1 - 1) >> TILE_SHIFT_X;
+    int ty0 = r.y0 >> TILE_SHIFT_Y;
+    int ty1 = ((r.y1 - 1) >> TILE_SHIFT_Y) + 1;
+
+    if (dirty_row0 >= dirty_row1) {
+        dirty_row0 = ty0;
+        dirty_row1 = ty1;
+    } else {
+        dirty_row0 = ty0 < dirty_row0 ? ty0 : dirty_row0;
+        dirty_row1 = ty1 > dirty_row1 ? ty1 : dirty_row1;
+    }
+
+    for (int ty = ty0; ty < ty1; ty++) {
+        uint64_t *row = dirty_tiles + (size_t)tile_words * ty;
+        for (int w = tx0 >> 6; w <= tx1 >> 6; w++) {
+            int lo = w == tx0 >> 6 ? tx0 & 63 : 0;
+            int hi = w == tx1 >> 6 ? tx1 & 63 : 63;
+            row[w] |= (~0ull >> (63 - hi)) & (~0ull << lo);
+        }
+    }
+
+    return;
+}
+
+/* whether any tile r reaches into is dirty */
+static int tiles_dirty(rect_t r) {
+    if (rect_empty(r))
+        return 0;
+
+    for (int ty = r.y0 >> TILE_SHIFT_Y; ty <= (r.y1 - 1) >> TILE_SHIFT_Y; ty++) {
+        uint64_t *row = dirty_tiles + (size_t)tile_words * ty;
+        for (int tx = r.x0 >> TILE_SHIFT_X; tx <= (r.x1 - 1) >> TILE_SHIFT_X; tx++)
+            if ((row[tx >> 6] >> (tx & 63)) & 1)
+                return 1;
+    }
+
+    return 0;
+}
+
+static void tiles_clear(void) {
+    for (int i = tile_words * dirty_row0; i < tile_words * dirty_row1; i++)
+        dirty_tiles[i] = 0;
+
+    dirty_row0 = dirty_row1 = 0;
+
+    return;
+}
+
+/* copies one span of the scene to the screen on each row of [y0, y1) */
+static void present_span(int x0, int x1, int y0, int y1) {
+    if (memewm_backend.format == MEMEWM_FORMAT_XRGB8888) {
+        for (int y = y0; y < y1; y++) {
+            size_t i = x0 + scene_pitch * y;
+            memewm_present32(memewm_framebuffer + i, antibuffer + i, x1 - x0);
+        }
+        return;
+    }
+
+    /* the screen has rows and pixels of its own size */
+    for (int y = y0; y < y1; y++) {
+        size_t i = x0 + scene_pitch * y;
+        uint8_t *dst = (uint8_t *)memewm_framebuffer + (size_t)memewm_screen_pitch * y
+                       + (size_t)x0 * memewm_screen_bytes;
+        memewm_present_convert(dst, antibuffer + i, x1 - x0);
+    }
+
+    return;
+}
+
+/* copies the dirty tiles of the rows [y0, y1) to the screen, every run
+   of them side by side is one span per row, so the screen only ever
+   sees long sequential writes */
+/* nothing is compared, the rest of a tile the damage did not reach is
+   what the screen shows already and rewritten as it is */
+static void present_tiles(int y0, int y1) {
+    int ty0 = y0 >> TILE_SHIFT_Y;
+    int ty1 = ((y1 - 1) >> TILE_SHIFT_Y) + 1;
+
+    if (ty0 < dirty_row0)
+        ty0 = dirty_row0;
+    if (ty1 > dirty_row1)
+        ty1 = dirty_row1;
+
+    for (int ty = ty0; ty < ty1; ty++) {
+        uint64_t *row = dirty_tiles + (size_t)tile_words * ty;
+        int ry0 = ty << TILE_SHIFT_Y;
+        int ry1 = (ty + 1) << TILE_SHIFT_Y;
+        int tx = 0;
+
+        if (ry0 < y0)
+            ry0 = y0;
+        if (ry1 > y1)
+            ry1 = y1;
+
+        while (tx < tile_cols) {
+            uint64_t bits = row[tx >> 6] >> (tx & 63);
+
+            /* skip to the next dirty tile, or past the word */
+            if (!bits) {
+                tx = (tx | 63) + 1;
+                continue;
+            }
+            tx += __builtin_ctzll(bits);
+
+            int start = tx;
+            while (tx < tile_cols && ((row[tx >> 6] >> (tx & 63)) & 1))
+                tx++;
+
+            int x1 = tx << TILE_SHIFT_X;
+            present_span(start << TILE_SHIFT_X, x1 < memewm_screen_width ? x1 : memewm_screen_width,
+                         ry0, ry1);
+        }
+    }
+
+    return;
+}
+
+/* composes and presents the damage that falls into one band, bands
+   share no pixels so they can run side by side */
+static void compose_band(void *arg, int band) {
+    compose_ctx_t *ctx = &compose_ctx[band];
+    rect_t rows = {0, band_y[band], memewm_screen_width, band_y[band + 1]};
+
+    (void)arg;
+
+    for (int i = 0; i < damage_count; i++) {
+        rect_t r = rect_intersect(damage_rects[i], rows);
+        if (!rect_empty(r))
+            compose_rect(ctx, r);
+    }
+
+    if (memewm_backend.buffer_count == 2)
+        return;
+
+    if (rows.y0 < rows.y1)
+        present_tiles(rows.y0, rows.y1);
+
+    return;
+}
+
+#ifdef MEMEWM_PARALLEL
+/* cuts the damaged rows into bands holding about the same number of
+   damaged pixels each, returns how many bands there are */
+static int split_bands(size_t damaged) {
+    int bands = memewm_parallel_workers();
+
+    if (bands > MAX_COMPOSE_BANDS)
+        bands = MAX_COMPOSE_BANDS;
+    if (bands < 2 || damaged < PARALLEL_MIN_PX)
+        return 1;
+
+    int y0 = memewm_screen_height;
+    int y1 = 0;
+    for (int i = 0; i < damage_count; i++) {
+        if (damage_rects[i].y0 < y0)
+            y0 = damage_rects[i].y0;
+        if (damage_rects[i].y1 > y1)
+            y1 = damage_rects[i].y1;
+    }
+
+    int band = 0;
+    size_t seen = 0;
+
+    band_y[0] = y0;
+    for (int y = y0; y < y1 && band < bands - 1; y++) {
+        for (int i = 0; i < damage_count; i++) {
+            if (y >= damage_rects[i].y0 && y < damage_rects[i].y1)
+                seen += damage_rects[i].x1 - damage_rects[i].x0;
+        }
+        if (seen * bands >= damaged * (band + 1))
+            band_y[++band] = y + 1;
+    }
+    band_y[++band] = y1;
+
+    return band;
+}
+#endif
+
+/* composes every damage rect, presenting them too on the copy path */
+static void compose_damage(void) {
+    int bands = 1;
+
+    band_y[0] = 0;
+    band_y[1] = memewm_screen_height;
+
+    /* marked up front, bands may split a tile row between them */
+    if (memewm_backend.buffer_count != 2) {
+        for (int i = 0; i < damage_count; i++)
+            tiles_mark(damage_rects[i]);
+    }
+
+#ifdef MEMEWM_PARALLEL
+    size_t damaged = 0;
+    for (int i = 0; i < damage_count; i++)
+        damaged += rect_area(damage_rects[i]);
+
+    bands = split_bands(damaged);
+    if (bands > 1)
+        memewm_parallel_run(compose_band, 0, bands);
+    else
+#endif
+        compose_band(0, 0);
+
+    for (int i = 0; i < bands; i++) {
+        memewm_stats.damaged_px += compose_ctx[i].stats.damaged_px;
+        memewm_stats.covered_px += compose_ctx[i].stats.covered_px;
+        memewm_stats.painted_px += compose_ctx[i].stats.painted_px;
+        compose_ctx[i].stats = (memewm_stats_t){0};
+    }
+
+    return;
+}
+
+/* draws the next frame into the hidden buffer and shows it */
+static void flip_refresh(void) {
+    int back = !flip_front;
+    rect_t fresh[MAX_DAMAGE_RECTS];
+    int fresh_count = damage_count;
+
+    for (int i = 0; i < damage_count; i++)
+        fresh[i] = damage_rects[i];
+
+    /* the hidden buffer still shows the frame before the one on screen,
+       bring it up to date and take its old cursor out along the way */
+    for (int i = 0; i < flip_damage_count; i++)
+        damage_rect(flip_damage[i]);
+    damage_rect(flip_cursor[back]);
+    damage_rect(cursor_rect(memewm_mouse_x, memewm_mouse_y));
+
+    antibuffer = memewm_backend.buffers[back];
+    memewm_framebuffer = memewm_backend.buffers[back];
+
+    compose_damage();
+    damage_count = 0;
+
+    cursor_show();
+    flip_cursor[back] = cursor_rect(cursor_x, cursor_y);
+
+    for (int i = 0; i < fresh_count; i++)
+        flip_damage[i] = fresh[i];
+    flip_damage_count = fresh_count;
+
+    memewm_backend.flip(memewm_backend.ctx, back);
+    flip_front = back;
+
+    return;
+}
+
+/* damages where the overview shows part t of a window's thumbnail */
+static void damage_thumbnail_area(window_t *wptr, rect_t t) {
+    int sx = wptr->overview_rect.x0 + 1;
+    int sy = wptr->overview_rect.y0 + 1;
+
+    damage_rect(rect_intersect((rect_t){sx + t.x0, sy + t.y0, sx + t.x1, sy + t.y1},
+                               wptr->overview_rect));
+
+    return;
+}
+
+/* deals the windows out over a grid of equal cells in the order of their
+   slots, so they keep their places as others come and go, each thumbnail
+   as big as a power of two smaller than its window that fits the cell */
+static void overview_layout(void) {
+    int count = 0;
+
+    for (window_t *wptr = windows; wptr; wptr = wptr->next)
+        count++;
+
+    overview_dirty = 0;
+    if (!count)
+        return;
+
+    int cols = 1;
+    while (cols * cols < count)
+        cols++;
+    int rows = (count + cols - 1) / cols;
+    int cell_width = memewm_screen_width / cols;
+    int cell_height = memewm_screen_height / rows;
+    /* what is left of a cell inside the margin and border */
+    int room_x = cell_width - 2 * OVERVIEW_MARGIN - 2;
+    int room_y = cell_height - 2 * OVERVIEW_MARGIN - 2;
+    int cell = 0;
+
+    for (int i = 0; i < window_slots_size; i++) {
+        window_t *wptr = window_slots[i].window;
+        if (!wptr)
+            continue;
+
+        rect_t c;
+        c.x0 = (cell % cols) * cell_width;
+        c.y0 = (cell / cols) * cell_height;
+        c.x1 = c.x0 + cell_width;
+        c.y1 = c.y0 + cell_height;
+        cell++;
+
+        int shift = 0;
+        while (shift < THUMBNAIL_MAX_SHIFT
+               && (((wptr->x_size + (1 << shift) - 1) >> shift) > room_x
+                   || ((wptr->y_size + (1 << shift) - 1) >> shift) > room_y))
+            shift++;
+
+        /* a thumbnail there was no room for keeps showing the old one */
+        rect_t changed;
+        thumbnail_update(wptr, shift, &changed);
+
+        int width = wptr->thumbnail_width + 2;
+        int height = wptr->thumbnail_height + 2;
+        int x = c.x0 + (cell_width - width) / 2;
+        int y = c.y0 + (cell_height - height) / 2;
+        rect_t r = rect_intersect((rect_t){x, y, x + width, y + height}, c);
+
+        if (!rect_equal(r, wptr->overview_rect)) {
+            damage_rect(wptr->overview_rect);
+            damage_rect(r);
+            wptr->overview_rect = r;
+        } else {
+            damage_thumbnail_area(wptr, changed);
+        }
+    }
+
+    return;
+}
+
+/* lays the overview out again if windows came, went or changed size and
+   brings every thumbnail up to date with what its window drew */
+static void overview_update(void) {
+    if (overview_dirty) {
+        overview_layout();
+        return;
+    }
+
+    for (window_t *wptr = windows; wptr; wptr = wptr->next) {
+        rect_t changed;
+
+        if (rect_empty(wptr->thumbnail_stale))
+            continue;
+
+        thumbnail_update(wptr, wptr->thumbnail_shift, &changed);
+        damage_thumbnail_area(wptr, changed);
+    }
+
+    return;
+}
+
+void memewm_refresh(void) {
+    if (overview)
+        overview_update();
+
+    if (!damage_count)
+        return;
+
+    if (memewm_backend.buffer_count == 2) {
+        flip_refresh();
+        return;
+    }
+
+    compose_damage();
+
+    /* presenting overwrites whatever part of the cursor the dirty tiles
+       cover, so that part gets saved again from the new scene and redrawn */
+    int cursor_damaged = !cursor_drawn || tiles_dirty(cursor_rect(cursor_x, cursor_y));
+
+    tiles_clear();
+    damage_count = 0;
+
+    if (cursor_damaged)
+        cursor_show();
+
+    return;
+}
+
+void memewm_set_cursor_pos(int x, int y) {
+    if (memewm_mouse_x + x < 0) {
+        memewm_mouse_x = 0;
+    } else if (memewm_mouse_x + x >= memewm_screen_width) {
+        memewm_mouse_x = memewm_screen_width - 1;
+    } else {
+        memewm_mouse_x += x;
+    }
+
+    if (memewm_mouse_y + y < 0) {
+        memewm_mouse_y = 0;
+    } else if (memewm_mouse_y + y >= memewm_screen_height) {
+        memewm_mouse_y = memewm_screen_height - 1;
+    } else {
+        memewm_mouse_y += y;
+    }
+
+    cursor_move();
+
+    return;
+}
+
+void memewm_set_cursor_pos_abs(int x, int y) {
+    if (x < 0) {
+        memewm_mouse_x = 0;
+    } else if (x >= memewm_screen_width) {
+        memewm_mouse_x = memewm_screen_width - 1;
+    } else {
+        memewm_mouse_x = x;
+    }
+
+    if (y < 0) {
+        memewm_mouse_y = 0;
+    } else if (y >= memewm_screen_height) {
+        memewm_mouse_y = memewm_screen_height - 1;
+    } else {
+        memewm_mouse_y = y;
+    }
+
+    cursor_move();
+
+    return;
+}
+
+void memewm_get_cursor_pos(int *x, int *y) {
+    *x = memewm_mouse_x;
+    *y = memewm_mouse_y;
+
+    return;
+}
+
+void memewm_get_stats(memewm_stats_t *stats) {
+    *stats = memewm_stats;
+
+    return;
+}
+
+void memewm_reset_stats(void) {
+    memewm_stats = (memewm_stats_t){0};
+
+    return;
+}
+
+window_click_data_t memewm_window_click(int x, int y) {
+    window_click_data_t ret = {0};
+    window_t *wptr = window_at(x, y);
+
+    if (!wptr) {
+        ret.id = -1;
+        return ret;
+    }
+
+    int in_canvas = 1;
+    ret.id = wptr->id;
+    ret.rel_x = ret.rel_y = -1;
+    if (y - wptr->y < TITLE_BAR_THICKNESS
+        && y - wptr->y > 0 && y - wptr->y < wptr->y_size + TITLE_BAR_THICKNESS
+        && x - wptr->x > 0 && x - wptr->x < wptr->x_size) {
+        in_canvas = 0;
+        ret.titlebar = 1;
+    } else {
+        ret.titlebar = 0;
+    }
+    if (y - wptr->y == 0) {
+        in_canvas = 0;
+        ret.top_border = 1;
+        ret.bottom_border = 0;
+    } else if (y - wptr->y == wptr->y_size + TITLE_BAR_THICKNESS) {
+        in_canvas = 0;
+        ret.bottom_border = 1;
+        ret.top_border = 0;
+    }
+    if (x - wptr->x == 0) {
+        in_canvas = 0;
+        ret.left_border = 1;
+        ret.right_border = 0;
+    } else if (x - wptr->x == wptr->x_size + 1) {
+        in_canvas = 0;
+        ret.right_border = 1;
+        ret.left_border = 0;
+    }
+    if (in_canvas) {
+        ret.rel_x = x - (wptr->x + 1);
+        ret.rel_y = y - (wptr->y + TITLE_BAR_THICKNESS);
+    }
+    return ret;
+}
+
+void memewm_window_plot_px(int x, int y, uint32_t hex, int window) {
+    window_t *wptr = get_window_ptr(window);
+
+    if (!wptr)
         return;
 
     if (!wptr->is_drawable)
@@ -600,9 +2004,209 @@ void memewm_window_plot_px(int x, int y, uint32_t hex, int window) {
     if (x >= wptr->x_size || y >= wptr->y_size || x < 0 || y < 0)
         return;
 
-    size_t fb_i = x + wptr->x_size * y;
+    size_t fb_i = x + (size_t)wptr->stride * y;
     wptr->framebuffer[fb_i] = hex;
-    memewm_needs_refresh = 1;
+
+    damage_window_area(wptr, (rect_t){x, y, x + 1, y + 1});
+
+    return;
+}
+
+/* looks up a drawable window and clips a rectangle of its surface to it */
+/* returns 0 when there is nothing to draw */
+static window_t *window_draw_area(int window, rect_t *r) {
+    window_t *wptr = get_window_ptr(window);
+
+    if (!wptr)
+        return 0;
+
+    if (!wptr->is_drawable)
+        return 0;
+
+    *r = rect_intersect(*r, (rect_t){0, 0, wptr->x_size, wptr->y_size});
+    if (rect_empty(*r))
+        return 0;
+
+    return wptr;
+}
+
+/* reports a rectangle of a window's surface as changed behind memewm's
+   back, the pixels are read on the next refresh */
+/* unlike the drawing calls this works on windows that are not drawable,
+   the client writes to its buffer regardless */
+void memewm_window_damage(int x, int y, int x_size, int y_size, int window) {
+    window_t *wptr = get_window_ptr(window);
+
+    if (!wptr)
+        return;
+
+    rect_t r = rect_intersect((rect_t){x, y, x + x_size, y + y_size},
+                              (rect_t){0, 0, wptr->x_size, wptr->y_size});
+    if (rect_empty(r))
+        return;
+
+    damage_window_area(wptr, r);
+
+    return;
+}
+
+void memewm_window_fill_rect(int x, int y, int x_size, int y_size, uint32_t hex, int window) {
+    rect_t r = {x, y, x + x_size, y + y_size};
+    window_t *wptr = window_draw_area(window, &r);
+
+    if (!wptr)
+        return;
+
+    for (int row = r.y0; row < r.y1; row++)
+        memewm_fill32(wptr->framebuffer + (size_t)wptr->stride * row + r.x0, r.x1 - r.x0, hex);
+
+    damage_window_area(wptr, r);
+
+    return;
+}
+
+/* copies x_size * y_size pixels from src, whose rows are pitch bytes apart */
+void memewm_window_blit(int x, int y, int x_size, int y_size,
+                        const uint32_t *src, size_t pitch, int window) {
+    rect_t r = {x, y, x + x_size, y + y_size};
+    window_t *wptr = window_draw_area(window, &r);
+
+    if (!wptr)
+        return;
+
+    /* skip the part of the source that was clipped away */
+    const uint8_t *src_row = (const uint8_t *)src + pitch * (r.y0 - y) + (r.x0 - x) * sizeof(uint32_t);
+
+    for (int row = r.y0; row < r.y1; row++, src_row += pitch)
+        memewm_copy32(wptr->framebuffer + (size_t)wptr->stride * row + r.x0,
+                      (const uint32_t *)src_row, r.x1 - r.x0);
+
+    damage_window_area(wptr, r);
+
+    return;
+}
+
+/* writes count pixels from src into one row, starting at x, y */
+void memewm_window_plot_span(int x, int y, const uint32_t *src, int count, int window) {
+    memewm_window_blit(x, y, count, 1, src, 0, window);
+
+    return;
+}
+
+/* draws str on one line from x, y, every glyph cell is opaque */
+void memewm_window_draw_text(int x, int y, const char *str, uint32_t hex_fg, uint32_t hex_bg,
+                             int window) {
+    rect_t r = {x, y, x + (int)memewm_strlen(str) * memewm_font_width, y + memewm_font_height};
+    window_t *wptr = window_draw_area(window, &r);
+
+    if (!wptr)
+        return;
+
+    for (int i = 0; str[i]; i++) {
+        int char_x = x + i * memewm_font_width;
+        if (char_x >= r.x1)
+            break;
+        rect_t g = rect_intersect((rect_t){char_x, y, char_x + memewm_font_width,
+                                           y + memewm_font_height}, r);
+        if (rect_empty(g))
+            continue;
+
+        draw_glyph(wptr->framebuffer + (size_t)wptr->stride * g.y0 + g.x0, wptr->stride, str[i],
+                   g.y0 - y, g.y1 - y, g.x0 - char_x, g.x1 - char_x, hex_fg, hex_bg);
+    }
+
+    damage_window_area(wptr, r);
+
+    return;
+}
+
+/* the window's surface box filtered down 1 << shift times, rows are
+   *width pixels apart */
+/* only the parts drawn to since it was last asked for, or shown in the
+   overview, are filtered again */
+/* returns null if there is no such window or no room for the thumbnail */
+const uint32_t *memewm_window_thumbnail(int window, int shift, int *width, int *height) {
+    window_t *wptr = get_window_ptr(window);
+    rect_t changed;
+
+    if (!wptr)
+        return (const uint32_t *)0;
+
+    if (shift < 0)
+        shift = 0;
+    if (shift > THUMBNAIL_MAX_SHIFT)
+        shift = THUMBNAIL_MAX_SHIFT;
+
+    /* the overview wants its own size back */
+    if (overview && shift != wptr->thumbnail_shift)
+        overview_dirty = 1;
+
+    if (thumbnail_update(wptr, shift, &changed))
+        return (const uint32_t *)0;
+
+    *width = wptr->thumbnail_width;
+    *height = wptr->thumbnail_height;
+
+    return wptr->thumbnail;
+}
+
+/* swaps the desktop for the overview, every window as a thumbnail in a
+   grid, or back */
+/* thumbnails are kept between overviews and only catch up on what was
+   drawn since, while it is up windows are drawn to as usual and show up
+   scaled down with the next refresh */
+void memewm_set_overview(int enable) {
+    enable = enable != 0;
+    if (enable == overview)
+        return;
+
+    overview = enable;
+    overview_dirty = 1;
+    damage_rect((rect_t){0, 0, memewm_screen_width, memewm_screen_height});
+
+    return;
+}
+
+/* the window whose thumbnail is at x, y while the overview is up */
+/* returns -1 if there is none */
+int memewm_overview_window_at(int x, int y) {
+    if (!overview)
+        return -1;
+
+    for (window_t *wptr = windows_tail; wptr; wptr = wptr->prev) {
+        rect_t o = wptr->overview_rect;
+        if (x >= o.x0 && x < o.x1 && y >= o.y0 && y < o.y1)
+            return wptr->id;
+    }
+
+    return -1;
+}
+
+/* 255 is opaque, anything less lets the windows behind show through */
+void memewm_window_set_opacity(int opacity, int window) {
+    window_t *wptr = get_window_ptr(window);
+
+    if (!wptr)
+        return;
+
+    wptr->alpha = opacity < 0 ? 0 : opacity > 255 ? 255 : opacity;
+    damage_window(wptr);
+
+    return;
+}
+
+/* with enable set the top byte of every surface pixel is taken as its
+   alpha, on top of the window's opacity */
+/* the title bar and borders stay as opaque as the window */
+void memewm_window_set_surface_alpha(int enable, int window) {
+    window_t *wptr = get_window_ptr(window);
+
+    if (!wptr)
+        return;
+
+    wptr->surface_alpha = enable != 0;
+    damage_window(wptr);
+
     return;
 }
 
@@ -15,18 +15,67 @@ typedef struct {
     int left_border;
 } window_click_data_t;
 
+/* compositor counters, accumulated over every refresh until reset */
+/* covered_px / damaged_px is the overdraw a back to front paint would have */
+/* painted_px / damaged_px is the overdraw after occlusion culling */
+typedef struct {
+    uint64_t damaged_px;
+    uint64_t covered_px;
+    uint64_t painted_px;
+} memewm_stats_t;
+
+/* screen pixel layouts, channels named from the most significant bit down */
+/* frames are always composed as xrgb8888, other formats are converted
+   as the damage is presented */
+enum {
+    MEMEWM_FORMAT_XRGB8888,
+    MEMEWM_FORMAT_XBGR8888,
+    MEMEWM_FORMAT_RGB888,   /* 3 bytes, blue first in memory */
+    MEMEWM_FORMAT_BGR888,
+    MEMEWM_FORMAT_RGB565,
+    MEMEWM_FORMAT_BGR565,
+};
+
+/* how composited frames reach the screen */
+/* with one buffer the damage is diffed into it, which is what memewm_init sets up */
+/* with two they take turns, frames are drawn straight into the hidden
+   one and flip() is called to show it, which needs MEMEWM_FORMAT_XRGB8888 */
+typedef struct {
+    int buffer_count;
+    uint32_t *buffers[2];
+    void (*flip)(void *ctx, int index);
+    void *ctx;
+    int format;             /* MEMEWM_FORMAT_*, zero is xrgb8888 */
+} memewm_backend_t;
+
 int memewm_init(uint32_t *, int, int, int, uint8_t *, int, int);
+int memewm_init_backend(const memewm_backend_t *, int, int, int, uint8_t *, int, int);
 
 void memewm_window_plot_px(int, int, uint32_t, int);
+void memewm_window_fill_rect(int, int, int, int, uint32_t, int);
+void memewm_window_blit(int, int, int, int, const uint32_t *, size_t, int);
+void memewm_window_plot_span(int, int, const uint32_t *, int, int);
+void memewm_window_draw_text(int, int, const char *, uint32_t, uint32_t, int);
+void memewm_window_set_opacity(int, int);
+void memewm_window_set_surface_alpha(int, int);
+const uint32_t *memewm_window_thumbnail(int, int, int *, int *);
 void memwm_make_window_toggle_drawable(int);
 int memewm_window_create(char *, size_t, size_t, size_t, size_t);
+int memewm_window_create_with_buffer(char *, size_t, size_t, size_t, size_t, uint32_t *, size_t, int);
+void memewm_window_damage(int, int, int, int, int);
+void memewm_window_destroy(int);
 void memewm_window_focus(int);
 void memewm_window_move(int, int, int);
 int memewm_window_resize(int, int, int);
 window_click_data_t memewm_window_click(int, int);
+void memewm_set_overview(int);
+int memewm_overview_window_at(int, int);
 void memewm_set_cursor_pos(int, int);
 void memewm_set_cursor_pos_abs(int, int);
 void memewm_get_cursor_pos(int *, int *);
 void memewm_refresh(void);
+void memewm_get_stats(memewm_stats_t *);
+void memewm_reset_stats(void);
+void memewm_set_nontemporal_present(int);
 
 #endif
@@ -0,0 +1,146 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "memewm_glue.h"
+#include "memewm_alloc.h"
+
+typedef struct free_block {
+    struct free_block *next;
+} free_block_t;
+
+/* small blocks come in 16, 32, 64, 128 and 256 bytes */
+#define SMALL_CLASSES 5
+#define SMALL_MIN_SHIFT 4
+/* small blocks are carved out of chunks this big, chunks are never freed */
+#define SMALL_CHUNK_SIZE 4096
+
+static free_block_t *small_free[SMALL_CLASSES];
+
+/* surface classes start at 1024 pixels and go up in quarter steps,
+   1024, 1280, 1536, 1792, 2048, 2560 and so on */
+#define SURFACE_MIN_SHIFT 10
+#define SURFACE_CLASSES 96
+/* freed surfaces kept per class, the rest go back to the glue */
+#define SURFACE_KEEP 4
+#define SURFACE_ALIGNMENT 64
+
+static free_block_t *surface_free[SURFACE_CLASSES];
+static int surface_free_count[SURFACE_CLASSES];
+
+static int small_class(size_t size) {
+    int class = 0;
+
+    while (((size_t)1 << (class + SMALL_MIN_SHIFT)) < size)
+        class++;
+
+    return class;
+}
+
+/* index of the highest set bit */
+static int log2_floor(size_t n) {
+    int log = 0;
+
+    while (n >>= 1)
+        log++;
+
+    return log;
+}
+
+static int surface_class(size_t pixels) {
+    if (pixels <= (size_t)1 << SURFACE_MIN_SHIFT)
+        return 0;
+
+    int log = log2_floor(pixels - 1);
+    size_t base = (size_t)1 << log;
+    size_t step = base >> 2;
+    int quarter = (pixels - base + step - 1) / step;
+
+    return (log - SURFACE_MIN_SHIFT) * 4 + quarter;
+}
+
+static size_t surface_class_size(int class) {
+    return (size_t)(4 + (class & 3)) << (class / 4 + SURFACE_MIN_SHIFT - 2);
+}
+
+void *memewm_small_alloc(size_t size) {
+    if (size > MEMEWM_SMALL_MAX)
+        return memewm_calloc(1, size);
+
+    int class = small_class(size);
+    size_t block_size = (size_t)1 << (class + SMALL_MIN_SHIFT);
+
+    if (!small_free[class]) {
+        uint8_t *chunk = memewm_aligned_alloc(SMALL_CHUNK_SIZE, SMALL_CHUNK_SIZE);
+        if (!chunk)
+            return (void *)0;
+
+        for (size_t i = 0; i < SMALL_CHUNK_SIZE; i += block_size) {
+            free_block_t *block = (free_block_t *)(chunk + i);
+            block->next = small_free[class];
+            small_free[class] = block;
+        }
+    }
+
+    free_block_t *block = small_free[class];
+    small_free[class] = block->next;
+
+    uint64_t *words = (uint64_t *)block;
+    for (size_t i = 0; i < block_size / sizeof(uint64_t); i++)
+        words[i] = 0;
+
+    return block;
+}
+
+void memewm_small_free(void *ptr, size_t size) {
+    if (!ptr)
+        return;
+
+    if (size > MEMEWM_SMALL_MAX) {
+        memewm_free(ptr);
+        return;
+    }
+
+    int class = small_class(size);
+    free_block_t *block = ptr;
+
+    block->next = small_free[class];
+    small_free[class] = block;
+
+    return;
+}
+
+uint32_t *memewm_surface_alloc(size_t pixels, size_t *capacity) {
+    int class = surface_class(pixels);
+
+    if (class >= SURFACE_CLASSES)
+        return (uint32_t *)0;
+
+    *capacity = surface_class_size(class);
+
+    if (surface_free[class]) {
+        free_block_t *block = surface_free[class];
+        surface_free[class] = block->next;
+        surface_free_count[class]--;
+        return (uint32_t *)block;
+    }
+
+    return memewm_aligned_alloc(SURFACE_ALIGNMENT, *capacity * sizeof(uint32_t));
+}
+
+void memewm_surface_free(uint32_t *surface, size_t capacity) {
+    if (!surface)
+        return;
+
+    int class = surface_class(capacity);
+
+    if (surface_free_count[class] == SURFACE_KEEP) {
+        memewm_free(surface);
+        return;
+    }
+
+    free_block_t *block = (free_block_t *)surface;
+    block->next = surface_free[class];
+    surface_free[class] = block;
+    surface_free_count[class]++;
+
+    return;
+}
@@ -0,0 +1,25 @@
+#ifndef __MEMEWM_ALLOC_H__
+#define __MEMEWM_ALLOC_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* allocators the core keeps on top of the glue, freed memory is kept on
+   free lists and handed out again instead of going back to the glue */
+
+/* zeroed blocks of up to MEMEWM_SMALL_MAX bytes carved out of pooled
+   chunks, bigger requests go straight to the glue */
+/* the size passed to memewm_small_free must be the one allocated with */
+#define MEMEWM_SMALL_MAX 256
+
+void *memewm_small_alloc(size_t size);
+void memewm_small_free(void *ptr, size_t size);
+
+/* pixel stores in size classes a quarter of a power of two apart */
+/* *capacity is set to the pixels actually available, which is what has
+   to be passed back to memewm_surface_free */
+/* the contents of a surface are undefined */
+uint32_t *memewm_surface_alloc(size_t pixels, size_t *capacity);
+void memewm_surface_free(uint32_t *surface, size_t capacity);
+
+#endif
@@ -4,6 +4,21 @@
 #include <stddef.h>
 
 void *memewm_malloc(size_t);
+/* count * size zeroed bytes */
+void *memewm_calloc(size_t, size_t);
+/* keeps the first min(old size, new size) bytes */
+void *memewm_realloc(void *, size_t);
+/* alignment is a power of two, and size a multiple of it */
+void *memewm_aligned_alloc(size_t, size_t);
+/* takes memory from any of the above */
 void memewm_free(void *);
 
+#ifdef MEMEWM_PARALLEL
+/* number of threads memewm_parallel_run spreads work across */
+int memewm_parallel_workers(void);
+/* calls fn(arg, i) for every i in [0, count), possibly at the same
+   time on different threads, and returns once all calls have returned */
+void memewm_parallel_run(void (*fn)(void *, int), void *arg, int count);
+#endif
+
 #endif
@@ -0,0 +1,566 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "memewm.h"
+#include "memewm_pixel.h"
+
+#if defined (__x86_64__) && defined (__SSE2__)
+#define MEMEWM_X86_SIMD
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+/* two pixels moved as one word, pixel buffers are only 4 byte aligned */
+typedef uint64_t __attribute__((may_alias, aligned(4))) pixel_pair_t;
+
+/* screens with 16 and 24 bit pixels put them at any byte */
+typedef uint16_t __attribute__((may_alias, aligned(1))) screen16_t;
+typedef uint32_t __attribute__((may_alias, aligned(1))) screen32_t;
+
+static int memewm_nontemporal_present = 0;
+static int memewm_screen_format = MEMEWM_FORMAT_XRGB8888;
+
+/* word-wise kernels, these are all the freestanding -mno-sse builds get */
+
+static void fill32_scalar(uint32_t *dst, size_t count, uint32_t hex) {
+    uint64_t pair = ((uint64_t)hex << 32) | hex;
+    size_t i = 0;
+
+    for (; i + 2 <= count; i += 2)
+        *(pixel_pair_t *)(dst + i) = pair;
+    if (i < count)
+        dst[i] = hex;
+
+    return;
+}
+
+static void copy32_scalar(uint32_t *dst, const uint32_t *src, size_t count) {
+    size_t i = 0;
+
+    for (; i + 2 <= count; i += 2)
+        *(pixel_pair_t *)(dst + i) = *(const pixel_pair_t *)(src + i);
+    if (i < count)
+        dst[i] = src[i];
+
+    return;
+}
+
+/* one channel of s over d at alpha out of 255, rounded the way
+   the vector kernels do it */
+static inline uint32_t blend_channel(uint32_t s, uint32_t d, uint32_t alpha) {
+    uint32_t t = s * alpha + d * (255 - alpha) + 128;
+
+    return (t + (t >> 8)) >> 8;
+}
+
+uint32_t memewm_blend_px(uint32_t src, uint32_t dst, uint32_t alpha) {
+    uint32_t out = 0;
+
+    for (int shift = 0; shift < 32; shift += 8)
+        out |= blend_channel((src >> shift) & 0xff, (dst >> shift) & 0xff, alpha) << shift;
+
+    return out;
+}
+
+static void blend32_scalar(uint32_t *dst, const uint32_t *src, size_t count, uint32_t alpha) {
+    for (size_t i = 0; i < count; i++)
+        dst[i] = memewm_blend_px(src[i], dst[i], alpha);
+
+    return;
+}
+
+static void blend32_argb_scalar(uint32_t *dst, const uint32_t *src, size_t count, uint32_t alpha) {
+    for (size_t i = 0; i < count; i++)
+        dst[i] = memewm_blend_px(src[i], dst[i], blend_channel(src[i] >> 24, 0, alpha));
+
+    return;
+}
+
+void memewm_downscale_row(uint32_t *dst, const uint32_t *src, size_t stride, size_t count,
+                          int shift, int width, int rows) {
+    int block = 1 << shift;
+
+    for (size_t i = 0; i < count; i++, src += block, width -= block) {
+        int cols = width < block ? width : block;
+        uint32_t sum[4] = {0, 0, 0, 0};
+
+        for (int y = 0; y < rows; y++) {
+            const uint32_t *px = src + stride * y;
+            for (int x = 0; x < cols; x++) {
+                sum[0] += px[x] & 0xff;
+                sum[1] += (px[x] >> 8) & 0xff;
+                sum[2] += (px[x] >> 16) & 0xff;
+                sum[3] += px[x] >> 24;
+            }
+        }
+
+        /* blocks are mostly whole, dividing by a power of two is a shift */
+        uint32_t n = cols * rows;
+        uint32_t out = 0;
+        if (n == (uint32_t)block * block) {
+            for (int c = 0; c < 4; c++)
+                out |= ((sum[c] + (n >> 1)) >> (2 * shift)) << (8 * c);
+        } else {
+            for (int c = 0; c < 4; c++)
+                out |= ((sum[c] + (n >> 1)) / n) << (8 * c);
+        }
+        dst[i] = out;
+    }
+
+    return;
+}
+
+/* kernels that convert while presenting, one set per screen format */
+/* each format is a store(dst, i, hex) writing pixel i of a span */
+
+#define STORE_XBGR8888(dst, i, hex) \
+    (((screen32_t *)(dst))[i] = ((hex) & 0xff00ff00) | (((hex) >> 16) & 0xff) | (((hex) & 0xff) << 16))
+
+#define STORE_RGB565(dst, i, hex) \
+    (((screen16_t *)(dst))[i] = (((hex) >> 8) & 0xf800) | (((hex) >> 5) & 0x07e0) | (((hex) >> 3) & 0x001f))
+
+#define STORE_BGR565(dst, i, hex) \
+    (((screen16_t *)(dst))[i] = (((hex) << 8) & 0xf800) | (((hex) >> 5) & 0x07e0) | (((hex) >> 19) & 0x001f))
+
+/* 24 bit pixels are stored lowest byte first, rgb888 puts blue there */
+#define STORE_RGB888(dst, i, hex) do { \
+    uint8_t *px = (uint8_t *)(dst) + 3 * (i); \
+    px[0] = (hex); \
+    px[1] = (hex) >> 8; \
+    px[2] = (hex) >> 16; \
+} while (0)
+
+#define STORE_BGR888(dst, i, hex) do { \
+    uint8_t *px = (uint8_t *)(dst) + 3 * (i); \
+    px[0] = (hex) >> 16; \
+    px[1] = (hex) >> 8; \
+    px[2] = (hex); \
+} while (0)
+
+#define DEFINE_FORMAT_SCALAR(name, store) \
+static void store_px_##name(void *dst, uint32_t hex) { \
+    store(dst, 0, hex); \
+\
+    return; \
+} \
+\
+static void present_##name##_scalar(void *dst, const uint32_t *src, size_t count) { \
+    for (size_t i = 0; i < count; i++) \
+        store(dst, i, src[i]); \
+\
+    return; \
+}
+
+DEFINE_FORMAT_SCALAR(xbgr8888, STORE_XBGR8888)
+DEFINE_FORMAT_SCALAR(rgb888, STORE_RGB888)
+DEFINE_FORMAT_SCALAR(bgr888, STORE_BGR888)
+DEFINE_FORMAT_SCALAR(rgb565, STORE_RGB565)
+DEFINE_FORMAT_SCALAR(bgr565, STORE_BGR565)
+
+static void store_px_xrgb8888(void *dst, uint32_t hex) {
+    *(screen32_t *)dst = hex;
+
+    return;
+}
+
+#ifdef MEMEWM_X86_SIMD
+
+static void fill32_sse2(uint32_t *dst, size_t count, uint32_t hex) {
+    __m128i v = _mm_set1_epi32(hex);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_si128((__m128i *)(dst + i), v);
+    for (; i < count; i++)
+        dst[i] = hex;
+
+    return;
+}
+
+static void copy32_sse2(uint32_t *dst, const uint32_t *src, size_t count) {
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_loadu_si128((const __m128i *)(src + i)));
+    for (; i < count; i++)
+        dst[i] = src[i];
+
+    return;
+}
+
+/* copy32 with streaming stores into dst, they bypass the cache and fill
+   whole write-combining lines, but need dst aligned to the vector */
+static void present32_sse2_nt(uint32_t *dst, const uint32_t *src, size_t count) {
+    size_t i = 0;
+
+    for (; i < count && ((uintptr_t)(dst + i) & 15); i++)
+        dst[i] = src[i];
+    for (; i + 4 <= count; i += 4)
+        _mm_stream_si128((__m128i *)(dst + i), _mm_loadu_si128((const __m128i *)(src + i)));
+    for (; i < count; i++)
+        dst[i] = src[i];
+
+    _mm_sfence();
+
+    return;
+}
+
+__attribute__((target("avx2")))
+static void fill32_avx2(uint32_t *dst, size_t count, uint32_t hex) {
+    __m256i v = _mm256_set1_epi32(hex);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+        _mm256_storeu_si256((__m256i *)(dst + i), v);
+    for (; i < count; i++)
+        dst[i] = hex;
+
+    return;
+}
+
+__attribute__((target("avx2")))
+static void copy32_avx2(uint32_t *dst, const uint32_t *src, size_t count) {
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_loadu_si256((const __m256i *)(src + i)));
+    for (; i < count; i++)
+        dst[i] = src[i];
+
+    return;
+}
+
+__attribute__((target("avx2")))
+static void present32_avx2_nt(uint32_t *dst, const uint32_t *src, size_t count) {
+    size_t i = 0;
+
+    for (; i < count && ((uintptr_t)(dst + i) & 31); i++)
+        dst[i] = src[i];
+    for (; i + 8 <= count; i += 8)
+        _mm256_stream_si256((__m256i *)(dst + i), _mm256_loadu_si256((const __m256i *)(src + i)));
+    for (; i < count; i++)
+        dst[i] = src[i];
+
+    _mm_sfence();
+
+    return;
+}
+
+/* the blends widen channels to 16 bit lanes, where s * a + d * (255 - a)
+   still fits, and divide by 255 like blend_channel */
+static inline __m128i blend_epu16_sse2(__m128i s, __m128i d, __m128i a) {
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(s, a),
+                              _mm_mullo_epi16(d, _mm_sub_epi16(_mm_set1_epi16(255), a)));
+    t = _mm_add_epi16(t, _mm_set1_epi16(128));
+
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+/* the alpha of each of the two pixels in s, in all four of its lanes,
+   scaled by the window's */
+static inline __m128i pixel_alpha_sse2(__m128i s, __m128i alpha) {
+    __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xff), 0xff);
+
+    return blend_epu16_sse2(a, _mm_setzero_si128(), alpha);
+}
+
+__attribute__((always_inline))
+static inline void blend32_sse2_body(uint32_t *dst, const uint32_t *src, size_t count,
+                                     uint32_t alpha, int argb) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i a = _mm_set1_epi16(alpha);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+        __m128i s_lo = _mm_unpacklo_epi8(s, zero);
+        __m128i s_hi = _mm_unpackhi_epi8(s, zero);
+        __m128i a_lo = argb ? pixel_alpha_sse2(s_lo, a) : a;
+        __m128i a_hi = argb ? pixel_alpha_sse2(s_hi, a) : a;
+        __m128i lo = blend_epu16_sse2(s_lo, _mm_unpacklo_epi8(d, zero), a_lo);
+        __m128i hi = blend_epu16_sse2(s_hi, _mm_unpackhi_epi8(d, zero), a_hi);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+
+    if (argb)
+        blend32_argb_scalar(dst + i, src + i, count - i, alpha);
+    else
+        blend32_scalar(dst + i, src + i, count - i, alpha);
+
+    return;
+}
+
+static void blend32_sse2(uint32_t *dst, const uint32_t *src, size_t count, uint32_t alpha) {
+    blend32_sse2_body(dst, src, count, alpha, 0);
+
+    return;
+}
+
+static void blend32_argb_sse2(uint32_t *dst, const uint32_t *src, size_t count, uint32_t alpha) {
+    blend32_sse2_body(dst, src, count, alpha, 1);
+
+    return;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i blend_epu16_avx2(__m256i s, __m256i d, __m256i a) {
+    __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(s, a),
+                                 _mm256_mullo_epi16(d, _mm256_sub_epi16(_mm256_set1_epi16(255), a)));
+    t = _mm256_add_epi16(t, _mm256_set1_epi16(128));
+
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i pixel_alpha_avx2(__m256i s, __m256i alpha) {
+    __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, 0xff), 0xff);
+
+    return blend_epu16_avx2(a, _mm256_setzero_si256(), alpha);
+}
+
+/* unpacking and packing both stay within 128 bit halves, so pixels come
+   back out in the order they went in */
+__attribute__((target("avx2"), always_inline))
+static inline void blend32_avx2_body(uint32_t *dst, const uint32_t *src, size_t count,
+                                     uint32_t alpha, int argb) {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i a = _mm256_set1_epi16(alpha);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+        __m256i s_lo = _mm256_unpacklo_epi8(s, zero);
+        __m256i s_hi = _mm256_unpackhi_epi8(s, zero);
+        __m256i a_lo = argb ? pixel_alpha_avx2(s_lo, a) : a;
+        __m256i a_hi = argb ? pixel_alpha_avx2(s_hi, a) : a;
+        __m256i lo = blend_epu16_avx2(s_lo, _mm256_unpacklo_epi8(d, zero), a_lo);
+        __m256i hi = blend_epu16_avx2(s_hi, _mm256_unpackhi_epi8(d, zero), a_hi);
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_packus_epi16(lo, hi));
+    }
+
+    if (argb)
+        blend32_argb_sse2(dst + i, src + i, count - i, alpha);
+    else
+        blend32_sse2(dst + i, src + i, count - i, alpha);
+
+    return;
+}
+
+__attribute__((target("avx2")))
+static void blend32_avx2(uint32_t *dst, const uint32_t *src, size_t count, uint32_t alpha) {
+    blend32_avx2_body(dst, src, count, alpha, 0);
+
+    return;
+}
+
+__attribute__((target("avx2")))
+static void blend32_argb_avx2(uint32_t *dst, const uint32_t *src, size_t count, uint32_t alpha) {
+    blend32_avx2_body(dst, src, count, alpha, 1);
+
+    return;
+}
+
+/* the vector variants take four pixels at a time, convert(v) turns them
+   into the screen format and store(dst, i, v) writes out pixels i to i + 3 */
+/* whatever does not fill a vector is left to the scalar kernel */
+#define DEFINE_PRESENT_VECTOR(name, isa, bytes, convert, store) \
+__attribute__((target(#isa))) \
+static void present_##name##_##isa(void *dst, const uint32_t *src, size_t count) { \
+    size_t i = 0; \
+\
+    for (; i + 4 <= count; i += 4) \
+        store(dst, i, convert(_mm_loadu_si128((const __m128i *)(src + i)))); \
+\
+    present_##name##_scalar((uint8_t *)dst + (bytes) * i, src + i, count - i); \
+\
+    return; \
+}
+
+static inline __m128i convert_xbgr8888(__m128i s) {
+    __m128i ag = _mm_and_si128(s, _mm_set1_epi32(0xff00ff00));
+    __m128i r = _mm_and_si128(_mm_srli_epi32(s, 16), _mm_set1_epi32(0xff));
+    __m128i b = _mm_and_si128(_mm_slli_epi32(s, 16), _mm_set1_epi32(0xff0000));
+
+    return _mm_or_si128(ag, _mm_or_si128(r, b));
+}
+
+/* packs 32 bit lanes holding 16 bit values into the low half, packs
+   saturates signed so the values are biased into range and back */
+static inline __m128i pack_u16(__m128i v) {
+    v = _mm_packs_epi32(_mm_sub_epi32(v, _mm_set1_epi32(0x8000)), _mm_setzero_si128());
+
+    return _mm_add_epi16(v, _mm_set1_epi16(-0x8000));
+}
+
+static inline __m128i convert_rgb565(__m128i s) {
+    __m128i r = _mm_and_si128(_mm_srli_epi32(s, 8), _mm_set1_epi32(0xf800));
+    __m128i g = _mm_and_si128(_mm_srli_epi32(s, 5), _mm_set1_epi32(0x07e0));
+    __m128i b = _mm_and_si128(_mm_srli_epi32(s, 3), _mm_set1_epi32(0x001f));
+
+    return pack_u16(_mm_or_si128(r, _mm_or_si128(g, b)));
+}
+
+static inline __m128i convert_bgr565(__m128i s) {
+    __m128i b = _mm_and_si128(_mm_slli_epi32(s, 8), _mm_set1_epi32(0xf800));
+    __m128i g = _mm_and_si128(_mm_srli_epi32(s, 5), _mm_set1_epi32(0x07e0));
+    __m128i r = _mm_and_si128(_mm_srli_epi32(s, 19), _mm_set1_epi32(0x001f));
+
+    return pack_u16(_mm_or_si128(r, _mm_or_si128(g, b)));
+}
+
+/* drops the fourth byte of every pixel, 12 bytes come out */
+__attribute__((target("ssse3")))
+static inline __m128i convert_rgb888(__m128i s) {
+    return _mm_shuffle_epi8(s, _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14,
+                                             -1, -1, -1, -1));
+}
+
+__attribute__((target("ssse3")))
+static inline __m128i convert_bgr888(__m128i s) {
+    return _mm_shuffle_epi8(s, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                             -1, -1, -1, -1));
+}
+
+#define STORE_VECTOR32(dst, i, v) _mm_storeu_si128((__m128i *)((screen32_t *)(dst) + (i)), v)
+#define STORE_VECTOR16(dst, i, v) _mm_storel_epi64((__m128i *)((screen16_t *)(dst) + (i)), v)
+#define STORE_VECTOR24(dst, i, v) do { \
+    uint8_t *px = (uint8_t *)(dst) + 3 * (i); \
+    _mm_storel_epi64((__m128i *)px, v); \
+    *(screen32_t *)(px + 8) = _mm_cvtsi128_si32(_mm_srli_si128(v, 8)); \
+} while (0)
+
+DEFINE_PRESENT_VECTOR(xbgr8888, sse2, 4, convert_xbgr8888, STORE_VECTOR32)
+DEFINE_PRESENT_VECTOR(rgb565, sse2, 2, convert_rgb565, STORE_VECTOR16)
+DEFINE_PRESENT_VECTOR(bgr565, sse2, 2, convert_bgr565, STORE_VECTOR16)
+DEFINE_PRESENT_VECTOR(rgb888, ssse3, 3, convert_rgb888, STORE_VECTOR24)
+DEFINE_PRESENT_VECTOR(bgr888, ssse3, 3, convert_bgr888, STORE_VECTOR24)
+
+static int cpu_has_ssse3(void) {
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return 0;
+
+    return (ecx & bit_SSSE3) != 0;
+}
+
+static int cpu_has_avx2(void) {
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return 0;
+
+    /* the cpu having avx is not enough, the os has to save the ymm state */
+    if (!(ecx & bit_OSXSAVE) || !(ecx & bit_AVX))
+        return 0;
+
+    uint32_t xcr0_lo, xcr0_hi;
+    asm volatile ("xgetbv" : "=a" (xcr0_lo), "=d" (xcr0_hi) : "c" (0));
+    if ((xcr0_lo & 6) != 6)
+        return 0;
+
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+        return 0;
+
+    return (ebx & bit_AVX2) != 0;
+}
+
+#endif
+
+typedef struct {
+    int bytes;
+    void (*store_px)(void *, uint32_t);
+    void (*present)(void *, const uint32_t *, size_t);
+} format_t;
+
+/* xrgb8888 needs no conversion and goes through memewm_present32 */
+static const format_t formats[] = {
+    [MEMEWM_FORMAT_XRGB8888] = {4, store_px_xrgb8888, 0},
+    [MEMEWM_FORMAT_XBGR8888] = {4, store_px_xbgr8888, present_xbgr8888_scalar},
+    [MEMEWM_FORMAT_RGB888] = {3, store_px_rgb888, present_rgb888_scalar},
+    [MEMEWM_FORMAT_BGR888] = {3, store_px_bgr888, present_bgr888_scalar},
+    [MEMEWM_FORMAT_RGB565] = {2, store_px_rgb565, present_rgb565_scalar},
+    [MEMEWM_FORMAT_BGR565] = {2, store_px_bgr565, present_bgr565_scalar},
+};
+
+void (*memewm_fill32)(uint32_t *, size_t, uint32_t) = fill32_scalar;
+void (*memewm_copy32)(uint32_t *, const uint32_t *, size_t) = copy32_scalar;
+void (*memewm_present32)(uint32_t *, const uint32_t *, size_t) = copy32_scalar;
+void (*memewm_blend32)(uint32_t *, const uint32_t *, size_t, uint32_t) = blend32_scalar;
+void (*memewm_blend32_argb)(uint32_t *, const uint32_t *, size_t, uint32_t) = blend32_argb_scalar;
+void (*memewm_present_convert)(void *, const uint32_t *, size_t) = 0;
+void (*memewm_store_px)(void *, uint32_t) = store_px_xrgb8888;
+
+int memewm_format_bytes(int format) {
+    if (format < 0 || format >= (int)(sizeof(formats) / sizeof(formats[0])))
+        return 0;
+
+    return formats[format].bytes;
+}
+
+void memewm_pixel_init(void) {
+    memewm_fill32 = fill32_scalar;
+    memewm_copy32 = copy32_scalar;
+    memewm_present32 = copy32_scalar;
+    memewm_blend32 = blend32_scalar;
+    memewm_blend32_argb = blend32_argb_scalar;
+    memewm_present_convert = formats[memewm_screen_format].present;
+    memewm_store_px = formats[memewm_screen_format].store_px;
+
+#ifdef MEMEWM_X86_SIMD
+    switch (memewm_screen_format) {
+        case MEMEWM_FORMAT_XBGR8888:
+            memewm_present_convert = present_xbgr8888_sse2;
+            break;
+        case MEMEWM_FORMAT_RGB565:
+            memewm_present_convert = present_rgb565_sse2;
+            break;
+        case MEMEWM_FORMAT_BGR565:
+            memewm_present_convert = present_bgr565_sse2;
+            break;
+        case MEMEWM_FORMAT_RGB888:
+            if (cpu_has_ssse3())
+                memewm_present_convert = present_rgb888_ssse3;
+            break;
+        case MEMEWM_FORMAT_BGR888:
+            if (cpu_has_ssse3())
+                memewm_present_convert = present_bgr888_ssse3;
+            break;
+    }
+
+    /* sse2 is part of the x86_64 baseline */
+    memewm_fill32 = fill32_sse2;
+    memewm_copy32 = copy32_sse2;
+    memewm_present32 = memewm_nontemporal_present ? present32_sse2_nt : copy32_sse2;
+    memewm_blend32 = blend32_sse2;
+    memewm_blend32_argb = blend32_argb_sse2;
+
+    if (cpu_has_avx2()) {
+        memewm_fill32 = fill32_avx2;
+        memewm_copy32 = copy32_avx2;
+        memewm_present32 = memewm_nontemporal_present ? present32_avx2_nt : copy32_avx2;
+        memewm_blend32 = blend32_avx2;
+        memewm_blend32_argb = blend32_argb_avx2;
+    }
+#endif
+
+    return;
+}
+
+/* the format memewm_present_convert and memewm_store_px write */
+void memewm_pixel_set_format(int format) {
+    memewm_screen_format = format;
+    memewm_pixel_init();
+
+    return;
+}
+
+/* use streaming stores when presenting to the screen, worth it when the
+   framebuffer is mapped write-combining */
+void memewm_set_nontemporal_present(int enable) {
+    memewm_nontemporal_present = enable;
+    memewm_pixel_init();
+
+    return;
+}
@@ -0,0 +1,43 @@
+#ifndef __MEMEWM_PIXEL_H__
+#define __MEMEWM_PIXEL_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* span kernels the compositor runs its inner loops through */
+/* memewm_pixel_init() points them at the widest variant the cpu supports */
+
+/* dst[0..count) = hex */
+extern void (*memewm_fill32)(uint32_t *dst, size_t count, uint32_t hex);
+/* dst[0..count) = src[0..count) */
+extern void (*memewm_copy32)(uint32_t *dst, const uint32_t *src, size_t count);
+/* copy32 into the screen, with streaming stores if asked for */
+extern void (*memewm_present32)(uint32_t *dst, const uint32_t *src, size_t count);
+
+/* dst[i] = (src[i] * alpha + dst[i] * (255 - alpha)) / 255, every byte on its own, rounded */
+extern void (*memewm_blend32)(uint32_t *dst, const uint32_t *src, size_t count, uint32_t alpha);
+/* same, with alpha first scaled by the top byte of each src pixel */
+extern void (*memewm_blend32_argb)(uint32_t *dst, const uint32_t *src, size_t count, uint32_t alpha);
+/* one pixel of memewm_blend32 */
+uint32_t memewm_blend_px(uint32_t src, uint32_t dst, uint32_t alpha);
+/* box filters a row of 1 << shift square blocks of src, whose rows are
+   stride pixels apart, into dst[0..count), each pixel the rounded mean of
+   every byte of its block */
+/* only width pixels of src and rows rows are there to read, blocks
+   reaching past them are averaged over what they do cover */
+/* shift has to stay below 13 so the sums fit */
+void memewm_downscale_row(uint32_t *dst, const uint32_t *src, size_t stride, size_t count,
+                          int shift, int width, int rows);
+/* present32 for screens in any format but MEMEWM_FORMAT_XRGB8888, pixels
+   are converted on their way to dst, the span's first screen pixel */
+extern void (*memewm_present_convert)(void *dst, const uint32_t *src, size_t count);
+/* writes one pixel at dst in the screen's format */
+extern void (*memewm_store_px)(void *dst, uint32_t hex);
+
+void memewm_pixel_init(void);
+/* picks the kernels for a MEMEWM_FORMAT_*, which has to be one memewm_format_bytes knows */
+void memewm_pixel_set_format(int format);
+/* bytes a pixel of a MEMEWM_FORMAT_* takes, 0 if there is no such format */
+int memewm_format_bytes(int format);
+
+#endif
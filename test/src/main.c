@@ -19,7 +19,7 @@
 	value;										\
 })
 
-static uint64_t ticks = 0;
+static volatile uint64_t ticks = 0;
 
 #define PIT_FREQUENCY_HZ 1000
 
@@ -140,6 +140,48 @@ typedef struct {
     uint8_t y_mov;
 } mouse_packet_t;
 
+typedef struct {
+    int32_t x_mov;
+    int32_t y_mov;
+    uint8_t buttons;
+} mouse_event_t;
+
+// mouse events go from the interrupt handler to the main loop through a
+// single producer, single consumer ring, neither side ever waits on the
+// other and the window manager is only ever touched by the main loop
+#define MOUSE_QUEUE_SIZE 64     // must be a power of 2
+
+static mouse_event_t mouse_queue[MOUSE_QUEUE_SIZE];
+static uint32_t mouse_queue_head = 0;   // only written by the handler
+static uint32_t mouse_queue_tail = 0;   // only written by the main loop
+
+// returns 0 and drops the event if the main loop has fallen behind
+static int mouse_enqueue(const mouse_event_t *event) {
+    uint32_t head = __atomic_load_n(&mouse_queue_head, __ATOMIC_RELAXED);
+    uint32_t tail = __atomic_load_n(&mouse_queue_tail, __ATOMIC_ACQUIRE);
+
+    if (head - tail == MOUSE_QUEUE_SIZE)
+        return 0;
+
+    mouse_queue[head & (MOUSE_QUEUE_SIZE - 1)] = *event;
+    __atomic_store_n(&mouse_queue_head, head + 1, __ATOMIC_RELEASE);
+
+    return 1;
+}
+
+static int mouse_dequeue(mouse_event_t *event) {
+    uint32_t tail = __atomic_load_n(&mouse_queue_tail, __ATOMIC_RELAXED);
+    uint32_t head = __atomic_load_n(&mouse_queue_head, __ATOMIC_ACQUIRE);
+
+    if (head == tail)
+        return 0;
+
+    *event = mouse_queue[tail & (MOUSE_QUEUE_SIZE - 1)];
+    __atomic_store_n(&mouse_queue_tail, tail + 1, __ATOMIC_RELEASE);
+
+    return 1;
+}
+
 static int handler_cycle = 0;
 static mouse_packet_t current_packet;
 static int discard_packet = 0;
@@ -177,72 +219,77 @@ __attribute__((interrupt)) static void mouse_handler(void *p) {
                 break;
             }
 
-            // process packet
-            int64_t x_mov, y_mov;
+            // decode the packet and leave the rest to the main loop
+            mouse_event_t event;
 
             if (current_packet.flags & (1 << 4)) {
-                x_mov = (int8_t)current_packet.x_mov;
+                event.x_mov = (int8_t)current_packet.x_mov;
             } else
-                x_mov = current_packet.x_mov;
+                event.x_mov = current_packet.x_mov;
 
             if (current_packet.flags & (1 << 5)) {
-                y_mov = (int8_t)current_packet.y_mov;
+                event.y_mov = (int8_t)current_packet.y_mov;
             } else
-                y_mov = current_packet.y_mov;
+                event.y_mov = current_packet.y_mov;
 
-            int last_x, last_y, new_x, new_y;
+            event.buttons = current_packet.flags & 7;
 
-            memewm_get_cursor_pos(&last_x, &last_y);
-            window_click_data_t last_click_data = memewm_window_click(last_x, last_y);
+            mouse_enqueue(&event);
+            break;
+        }
+    }
 
-            memewm_set_cursor_pos(x_mov, -y_mov);
+out:
+    pic_eoi(12);
+}
 
-            if (!(current_packet.flags & (1 << 0)))
-                break;
+static void handle_mouse(const mouse_event_t *event) {
+    int last_x, last_y, new_x, new_y;
 
-            memewm_get_cursor_pos(&new_x, &new_y);
+    memewm_get_cursor_pos(&last_x, &last_y);
+    window_click_data_t last_click_data = memewm_window_click(last_x, last_y);
 
-            int id = last_click_data.id;
+    memewm_set_cursor_pos(event->x_mov, -event->y_mov);
 
-            if (last_click_data.top_border) {
-                memewm_window_focus(id);
-                memewm_window_resize(0, -(new_y - last_y), id);
-                memewm_window_move(0, new_y - last_y, id);
-            }
+    if (!(event->buttons & (1 << 0)))
+        return;
 
-            if (last_click_data.bottom_border) {
-                memewm_window_focus(id);
-                memewm_window_resize(0, new_y - last_y, id);
-            }
+    memewm_get_cursor_pos(&new_x, &new_y);
 
-            if (last_click_data.left_border) {
-                memewm_window_focus(id);
-                memewm_window_resize(-(new_x - last_x), 0, id);
-                memewm_window_move(new_x - last_x, 0, id);
-            }
+    int id = last_click_data.id;
 
-            if (last_click_data.right_border) {
-                memewm_window_focus(id);
-                memewm_window_resize(new_x - last_x, 0, id);
-            }
+    if (last_click_data.top_border) {
+        memewm_window_focus(id);
+        memewm_window_resize(0, -(new_y - last_y), id);
+        memewm_window_move(0, new_y - last_y, id);
+    }
 
-            if (last_click_data.titlebar) {
-                memewm_window_focus(id);
-                memewm_window_move(new_x - last_x, new_y - last_y, id);
-            }
+    if (last_click_data.bottom_border) {
+        memewm_window_focus(id);
+        memewm_window_resize(0, new_y - last_y, id);
+    }
 
-            if (last_click_data.rel_x != -1 && last_click_data.rel_y != -1) {
-                memewm_window_focus(id);
-                memewm_window_plot_px(last_click_data.rel_x, last_click_data.rel_y,
-                                      0xffffff, id);
-            }
+    if (last_click_data.left_border) {
+        memewm_window_focus(id);
+        memewm_window_resize(-(new_x - last_x), 0, id);
+        memewm_window_move(new_x - last_x, 0, id);
+    }
 
-            break;
-        }
+    if (last_click_data.right_border) {
+        memewm_window_focus(id);
+        memewm_window_resize(new_x - last_x, 0, id);
     }
 
-out:
-    pic_eoi(12);
+    if (last_click_data.titlebar) {
+        memewm_window_focus(id);
+        memewm_window_move(new_x - last_x, new_y - last_y, id);
+    }
+
+    if (last_click_data.rel_x != -1 && last_click_data.rel_y != -1) {
+        memewm_window_focus(id);
+        memewm_window_plot_px(last_click_data.rel_x, last_click_data.rel_y,
+                              0xffffff, id);
+    }
 }
 
 struct idt_entry_t {
@@ -288,11 +335,6 @@ __attribute__((interrupt)) static void pit_handler(void *p) {
 
     ticks++;
 
-    // refresh wm at 30 hz
-    if (!(ticks % (PIT_FREQUENCY_HZ / 30))) {
-        memewm_refresh();
-    }
-
     pic_eoi(0);
 }
 
@@ -330,8 +372,50 @@ static void *balloc_aligned(size_t count, size_t alignment) {
     return ret;
 }
 
+// every block starts with its size, so realloc knows how much to copy
+typedef struct {
+    size_t size;
+    size_t pad;     // keeps the block behind it 16 byte aligned
+} block_header_t;
+
+static void *balloc_block(size_t count, size_t alignment) {
+    size_t header = alignment > sizeof(block_header_t) ? alignment : sizeof(block_header_t);
+    uint8_t *base = balloc_aligned(header + count, alignment);
+    block_header_t *block = (block_header_t *)(base + header) - 1;
+
+    block->size = count;
+    return base + header;
+}
+
 void *memewm_malloc(size_t count) {
-    return balloc_aligned(count, 4);
+    return balloc_block(count, 16);
+}
+
+void *memewm_calloc(size_t count, size_t size) {
+    uint64_t *ptr = memewm_malloc(count * size);
+
+    // blocks are 16 byte aligned, so rounding up to whole words stays
+    // clear of the next one
+    for (size_t i = 0; i < (count * size + 7) / 8; i++)
+        ptr[i] = 0;
+
+    return ptr;
+}
+
+void *memewm_realloc(void *ptr, size_t count) {
+    uint8_t *new_ptr = memewm_malloc(count);
+
+    if (ptr) {
+        size_t old_count = ((block_header_t *)ptr - 1)->size;
+        for (size_t i = 0; i < old_count && i < count; i++)
+            new_ptr[i] = ((uint8_t *)ptr)[i];
+    }
+
+    return new_ptr;
+}
+
+void *memewm_aligned_alloc(size_t alignment, size_t count) {
+    return balloc_block(count, alignment);
 }
 
 void memewm_free(void *ptr) {
@@ -373,8 +457,27 @@ void _start(void) {
     memewm_window_create("test3", 70, 70, 800, 400);
     memewm_window_create("test4", 90, 90, 800, 400);
 
+    uint64_t next_refresh = 0;
+
     asm volatile ("sti");
     for (;;) {
-        asm volatile ("hlt");
+        mouse_event_t event;
+
+        while (mouse_dequeue(&event))
+            handle_mouse(&event);
+
+        // refresh wm at 30 hz
+        if (ticks >= next_refresh) {
+            memewm_refresh();
+            next_refresh = ticks + PIT_FREQUENCY_HZ / 30;
+        }
+
+        // sleep until the next interrupt, sti only takes effect after the
+        // hlt so an event queued in between still wakes us up
+        asm volatile ("cli");
+        if (__atomic_load_n(&mouse_queue_head, __ATOMIC_ACQUIRE) == mouse_queue_tail)
+            asm volatile ("sti\n\thlt");
+        else
+            asm volatile ("sti");
     }
 }